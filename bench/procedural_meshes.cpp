@@ -0,0 +1,185 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "procedural_meshes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+/*!
+ * @return A random number in [min, max). The standard distributions are implementation-defined, so they would give different meshes on each platform.
+ */
+static float randomRange(std::mt19937& random, float min, float max)
+{
+    return min + (max - min) * static_cast<float>(static_cast<double>(random()) / 4294967296.0);
+}
+
+static Vertex lerp(const Vertex& a, const Vertex& b, float t)
+{
+    return Vertex{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+}
+
+/*!
+ * Adds a subdivided icosahedron projected on a sphere
+ * @param mesh The mesh to add the sphere to
+ * @param subdivisions The number of segments each edge of the icosahedron is split into, giving 20 * subdivisions² faces
+ * @param center The center of the sphere
+ * @param radius The radius of the sphere
+ */
+static void addSphere(BenchMesh& mesh, uint32_t subdivisions, const Vertex& center, float radius)
+{
+    const float phi = std::numbers::phi_v<float>;
+    const std::array<Vertex, 12> corners{ Vertex{ -1, phi, 0 }, Vertex{ 1, phi, 0 },   Vertex{ -1, -phi, 0 }, Vertex{ 1, -phi, 0 },
+                                          Vertex{ 0, -1, phi }, Vertex{ 0, 1, phi },    Vertex{ 0, -1, -phi }, Vertex{ 0, 1, -phi },
+                                          Vertex{ phi, 0, -1 }, Vertex{ phi, 0, 1 },    Vertex{ -phi, 0, -1 }, Vertex{ -phi, 0, 1 } };
+    constexpr std::array<std::array<uint32_t, 3>, 20> triangles{ { { 0, 11, 5 }, { 0, 5, 1 },  { 0, 1, 7 },   { 0, 7, 10 }, { 0, 10, 11 },
+                                                                   { 1, 5, 9 },  { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+                                                                   { 3, 9, 4 },  { 3, 4, 2 },  { 3, 2, 6 },   { 3, 6, 8 },  { 3, 8, 9 },
+                                                                   { 4, 9, 5 },  { 2, 4, 11 }, { 6, 2, 10 },  { 8, 6, 7 },  { 9, 8, 1 } } };
+
+    const auto project = [&](const Vertex& vertex)
+    {
+        const float scale = radius / std::sqrt(vertex.x * vertex.x + vertex.y * vertex.y + vertex.z * vertex.z);
+        return Vertex{ center.x + vertex.x * scale, center.y + vertex.y * scale, center.z + vertex.z * scale };
+    };
+
+    const auto n = static_cast<float>(subdivisions);
+    for (const auto& [i1, i2, i3] : triangles)
+    {
+        // Point at barycentric coordinates (i / n, j / n) of the triangle
+        const auto point = [&](uint32_t i, uint32_t j)
+        {
+            const Vertex along_edge = lerp(corners[i1], corners[i2], static_cast<float>(i) / n);
+            const Vertex along_other_edge = lerp(corners[i1], corners[i3], static_cast<float>(i) / n);
+            return project(i == 0 ? along_edge : lerp(along_edge, along_other_edge, static_cast<float>(j) / static_cast<float>(i)));
+        };
+
+        for (uint32_t i = 0; i < subdivisions; ++i)
+        {
+            for (uint32_t j = 0; j <= i; ++j)
+            {
+                mesh.addTriangle(point(i, j), point(i + 1, j), point(i + 1, j + 1));
+                if (j < i)
+                {
+                    mesh.addTriangle(point(i, j), point(i + 1, j + 1), point(i, j + 1));
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * Adds a box whose sides are subdivided in a grid of quads
+ * @param mesh The mesh to add the box to
+ * @param min The minimum corner of the box
+ * @param size The size of the box along each axis
+ * @param subdivisions The number of quads along each side of each face
+ */
+static void addBox(BenchMesh& mesh, const Vertex& min, const Vertex& size, uint32_t subdivisions)
+{
+    // Each side is given by its origin and two axes, oriented outwards
+    const std::array<std::array<Vertex, 3>, 6> sides{ { { min, Vertex{ 0, size.y, 0 }, Vertex{ size.x, 0, 0 } },
+                                                        { Vertex{ min.x, min.y, min.z + size.z }, Vertex{ size.x, 0, 0 }, Vertex{ 0, size.y, 0 } },
+                                                        { min, Vertex{ size.x, 0, 0 }, Vertex{ 0, 0, size.z } },
+                                                        { Vertex{ min.x, min.y + size.y, min.z }, Vertex{ 0, 0, size.z }, Vertex{ size.x, 0, 0 } },
+                                                        { min, Vertex{ 0, 0, size.z }, Vertex{ 0, size.y, 0 } },
+                                                        { Vertex{ min.x + size.x, min.y, min.z }, Vertex{ 0, size.y, 0 }, Vertex{ 0, 0, size.z } } } };
+
+    const auto n = static_cast<float>(subdivisions);
+    for (const auto& [origin, axis_u, axis_v] : sides)
+    {
+        const auto point = [&](uint32_t u, uint32_t v)
+        {
+            const float fu = static_cast<float>(u) / n;
+            const float fv = static_cast<float>(v) / n;
+            return Vertex{ origin.x + axis_u.x * fu + axis_v.x * fv, origin.y + axis_u.y * fu + axis_v.y * fv, origin.z + axis_u.z * fu + axis_v.z * fv };
+        };
+
+        for (uint32_t u = 0; u < subdivisions; ++u)
+        {
+            for (uint32_t v = 0; v < subdivisions; ++v)
+            {
+                mesh.addTriangle(point(u, v), point(u + 1, v), point(u + 1, v + 1));
+                mesh.addTriangle(point(u, v), point(u + 1, v + 1), point(u, v + 1));
+            }
+        }
+    }
+}
+
+BenchMesh makeMesh(MeshKind kind, size_t faces_count)
+{
+    BenchMesh mesh;
+    mesh.faces.reserve(faces_count);
+    mesh.vertices.reserve(faces_count * 3);
+    std::mt19937 random(1234);
+
+    switch (kind)
+    {
+    case MeshKind::Sphere:
+    {
+        const auto subdivisions = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(faces_count) / 20.0)));
+        addSphere(mesh, std::max(subdivisions, 1U), Vertex{}, 100.0F);
+        break;
+    }
+
+    case MeshKind::Terrain:
+    {
+        const auto cells = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(faces_count) / 2.0)));
+        std::vector<float> heights((cells + 1) * (cells + 1));
+        for (uint32_t y = 0; y <= cells; ++y)
+        {
+            for (uint32_t x = 0; x <= cells; ++x)
+            {
+                const float fx = static_cast<float>(x) / static_cast<float>(cells);
+                const float fy = static_cast<float>(y) / static_cast<float>(cells);
+                heights[y * (cells + 1) + x] = 20.0F * std::sin(fx * 7.0F) * std::cos(fy * 5.0F) + 5.0F * std::sin(fx * 31.0F + fy * 23.0F) + randomRange(random, -0.5F, 0.5F);
+            }
+        }
+
+        const auto point = [&](uint32_t x, uint32_t y)
+        {
+            return Vertex{ static_cast<float>(x), static_cast<float>(y), heights[y * (cells + 1) + x] };
+        };
+        for (uint32_t y = 0; y < cells; ++y)
+        {
+            for (uint32_t x = 0; x < cells; ++x)
+            {
+                mesh.addTriangle(point(x, y), point(x + 1, y), point(x + 1, y + 1));
+                mesh.addTriangle(point(x, y), point(x + 1, y + 1), point(x, y + 1));
+            }
+        }
+        break;
+    }
+
+    case MeshKind::Boxes:
+    {
+        constexpr uint32_t subdivisions = 4;
+        constexpr size_t box_faces = 6 * 2 * subdivisions * subdivisions;
+        const size_t boxes_count = std::max(faces_count / box_faces, size_t(1));
+        const auto grid_size = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(boxes_count))));
+        for (size_t box = 0; box < boxes_count; ++box)
+        {
+            const auto x = static_cast<float>(box % grid_size) * 25.0F;
+            const auto y = static_cast<float>(box / grid_size) * 25.0F;
+            addBox(mesh, Vertex{ x, y, 0 }, Vertex{ randomRange(random, 2.0F, 20.0F), randomRange(random, 2.0F, 20.0F), randomRange(random, 2.0F, 20.0F) }, subdivisions);
+        }
+        break;
+    }
+
+    case MeshKind::Shells:
+    {
+        constexpr uint32_t subdivisions = 3;
+        constexpr size_t shell_faces = 20 * subdivisions * subdivisions;
+        const size_t shells_count = std::max(faces_count / shell_faces, size_t(1));
+        for (size_t shell = 0; shell < shells_count; ++shell)
+        {
+            const Vertex center{ randomRange(random, 0.0F, 1000.0F), randomRange(random, 0.0F, 1000.0F), randomRange(random, 0.0F, 1000.0F) };
+            addSphere(mesh, subdivisions, center, randomRange(random, 1.0F, 10.0F));
+        }
+        break;
+    }
+    }
+
+    return mesh;
+}
@@ -0,0 +1,47 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Face.h"
+#include "Vertex.h"
+
+/*
+ * Procedural meshes generated at runtime, which are the same on every platform so that the measurements made on them are reproducible everywhere.
+ * The meshes are built like the ones loaded from STL files, with no vertex shared between faces, and their size is given as an approximate faces count.
+ */
+
+enum class MeshKind
+{
+    Sphere, // Subdivided icosahedron, smoothly curved everywhere
+    Terrain, // Height field with noise at several frequencies
+    Boxes, // CAD-like boxes of various sizes, with many flat regions
+    Shells, // Many small disconnected spheres
+};
+
+inline constexpr std::array mesh_kind_names{ "sphere", "terrain", "boxes", "shells" };
+
+struct BenchMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<Face> faces;
+
+    void addTriangle(const Vertex& v1, const Vertex& v2, const Vertex& v3)
+    {
+        const auto index = static_cast<uint32_t>(vertices.size());
+        vertices.insert(vertices.end(), { v1, v2, v3 });
+        faces.push_back(Face{ index, index + 1, index + 2 });
+    }
+};
+
+/*!
+ * Generates a procedural mesh
+ * @param kind The kind of mesh
+ * @param faces_count The approximate number of faces of the mesh
+ * @return The generated mesh, which is always the same for the same arguments
+ */
+BenchMesh makeMesh(MeshKind kind, size_t faces_count);
@@ -0,0 +1,204 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include <array>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Face.h"
+#include "TaskScheduler.h"
+#include "UnwrapOptions.h"
+#include "UnwrapResult.h"
+#include "Vertex.h"
+#include "procedural_meshes.h"
+#include "unwrap.h"
+#include "unwrap_stages.h"
+
+/*
+ * Benchmarks of the whole unwrapping and of its stages, on procedural meshes generated at runtime so that the results are reproducible everywhere
+ */
+
+/*!
+ * @return The mesh of the given kind and size, which is generated once and then kept for all the benchmarks
+ */
+static const BenchMesh& benchMesh(MeshKind kind, size_t faces_count)
+{
+    static std::map<std::pair<MeshKind, size_t>, BenchMesh> meshes;
+    auto iterator = meshes.find({ kind, faces_count });
+    if (iterator == meshes.end())
+    {
+        iterator = meshes.emplace(std::make_pair(kind, faces_count), makeMesh(kind, faces_count)).first;
+    }
+    return iterator->second;
+}
+
+static TaskScheduler& benchScheduler()
+{
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+/*!
+ * Output of the stages preceding the packing, computed once per mesh
+ */
+struct PreparedCharts
+{
+    std::pmr::vector<UVCoord> uv_coords;
+    std::pmr::vector<Face> uv_faces;
+    std::pmr::vector<uint32_t> uv_xref;
+    std::pmr::vector<std::pmr::vector<size_t>> charts;
+};
+
+static const PreparedCharts& preparedCharts(MeshKind kind, size_t faces_count)
+{
+    static std::map<std::pair<MeshKind, size_t>, PreparedCharts> prepared;
+    auto iterator = prepared.find({ kind, faces_count });
+    if (iterator == prepared.end())
+    {
+        const BenchMesh& mesh = benchMesh(kind, faces_count);
+        TaskScheduler& scheduler = benchScheduler();
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+        PreparedCharts charts;
+        const std::pmr::vector<FaceData> faces_data = makeFacesData(mesh.vertices, mesh.faces, scheduler, resource);
+        const std::pmr::vector<Vector> projection_normals = calculateProjectionNormals(faces_data, UnwrapOptions().angle_limit, scheduler, resource);
+        const auto projected_faces_groups = groupFacesByProjectionNormal(faces_data, projection_normals, scheduler, resource);
+        charts.charts = makeCharts(
+            mesh.vertices,
+            mesh.faces,
+            faces_data,
+            projection_normals,
+            projected_faces_groups,
+            charts.uv_coords,
+            charts.uv_faces,
+            charts.uv_xref,
+            resource);
+        const std::pmr::vector<Face> welded_faces = groupSimilarVertices(mesh.faces, mesh.vertices, resource);
+        charts.charts = splitNonLinkedFacesCharts(charts.charts, welded_faces, resource);
+        iterator = prepared.emplace(std::make_pair(kind, faces_count), std::move(charts)).first;
+    }
+    return iterator->second;
+}
+
+static MeshKind meshKind(const benchmark::State& state)
+{
+    return static_cast<MeshKind>(state.range(0));
+}
+
+static size_t facesCount(const benchmark::State& state)
+{
+    return static_cast<size_t>(state.range(1));
+}
+
+static void setMeshLabel(benchmark::State& state, const BenchMesh& mesh, const std::string& suffix = {})
+{
+    state.SetLabel(std::string(mesh_kind_names[state.range(0)]) + "/" + std::to_string(mesh.faces.size()) + " faces" + suffix);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * mesh.faces.size()));
+}
+
+static void BM_SmartUnwrap(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    for (auto _ : state)
+    {
+        UnwrapResult result;
+        benchmark::DoNotOptimize(smartUnwrap(mesh.vertices, mesh.faces, result));
+    }
+    setMeshLabel(state, mesh);
+}
+
+static void BM_MakeFacesData(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(makeFacesData(mesh.vertices, mesh.faces, benchScheduler(), std::pmr::get_default_resource()));
+    }
+    setMeshLabel(state, mesh);
+}
+
+static void BM_CalculateProjectionNormals(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    const std::pmr::vector<FaceData> faces_data = makeFacesData(mesh.vertices, mesh.faces, benchScheduler(), std::pmr::get_default_resource());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(calculateProjectionNormals(faces_data, UnwrapOptions().angle_limit, benchScheduler(), std::pmr::get_default_resource()));
+    }
+    setMeshLabel(state, mesh);
+}
+
+static void BM_GroupSimilarVertices(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(groupSimilarVertices(mesh.faces, mesh.vertices, std::pmr::get_default_resource()));
+    }
+    setMeshLabel(state, mesh);
+}
+
+static void BM_SplitNonLinkedFacesCharts(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+    const std::pmr::vector<FaceData> faces_data = makeFacesData(mesh.vertices, mesh.faces, benchScheduler(), resource);
+    const std::pmr::vector<Vector> projection_normals = calculateProjectionNormals(faces_data, UnwrapOptions().angle_limit, benchScheduler(), resource);
+    const auto projected_faces_groups = groupFacesByProjectionNormal(faces_data, projection_normals, benchScheduler(), resource);
+    std::pmr::vector<UVCoord> uv_coords(resource);
+    std::pmr::vector<Face> uv_faces(resource);
+    std::pmr::vector<uint32_t> uv_xref(resource);
+    const std::pmr::vector<std::pmr::vector<size_t>> charts
+        = makeCharts(mesh.vertices, mesh.faces, faces_data, projection_normals, projected_faces_groups, uv_coords, uv_faces, uv_xref, resource);
+    const std::pmr::vector<Face> welded_faces = groupSimilarVertices(mesh.faces, mesh.vertices, resource);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(splitNonLinkedFacesCharts(charts, welded_faces, resource));
+    }
+    setMeshLabel(state, mesh);
+}
+
+/*!
+ * Variants of the packing options, selected by state.range(2)
+ */
+static const std::array<std::pair<const char*, xatlas::PackOptions>, 6> pack_options_variants{ {
+    { "default", default_pack_options },
+    { "resolution 1024", xatlas::PackOptions{ .padding = 0, .resolution = 1024 } },
+    { "padding 2", xatlas::PackOptions{ .padding = 2, .resolution = 512 } },
+    { "no rotation", xatlas::PackOptions{ .padding = 0, .resolution = 512, .rotateChartsToAxis = false, .rotateCharts = false } },
+    { "block align", xatlas::PackOptions{ .padding = 0, .resolution = 512, .blockAlign = true } },
+    { "brute force", xatlas::PackOptions{ .padding = 0, .resolution = 512, .bruteForce = true } },
+} };
+
+static void BM_PackCharts(benchmark::State& state)
+{
+    const BenchMesh& mesh = benchMesh(meshKind(state), facesCount(state));
+    const PreparedCharts& charts = preparedCharts(meshKind(state), facesCount(state));
+    const auto& [options_name, pack_options] = pack_options_variants[state.range(2)];
+    const UnwrapOptions unwrap_options;
+    for (auto _ : state)
+    {
+        UnwrapContext context;
+        context.options = &unwrap_options;
+        context.scheduler = &benchScheduler();
+        UnwrapResult result;
+        benchmark::DoNotOptimize(packCharts(context, charts.uv_faces, charts.charts, charts.uv_coords, charts.uv_xref, result, pack_options));
+    }
+    setMeshLabel(state, mesh, std::string("/") + options_name);
+}
+
+static const std::vector<int64_t> mesh_kinds{ 0, 1, 2, 3 };
+static const std::vector<int64_t> faces_counts{ 1 << 12, 1 << 15, 1 << 18 };
+
+BENCHMARK(BM_SmartUnwrap)->ArgsProduct({ mesh_kinds, faces_counts })->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_MakeFacesData)->ArgsProduct({ mesh_kinds, faces_counts })->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_CalculateProjectionNormals)->ArgsProduct({ mesh_kinds, faces_counts })->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_GroupSimilarVertices)->ArgsProduct({ mesh_kinds, faces_counts })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SplitNonLinkedFacesCharts)->ArgsProduct({ mesh_kinds, faces_counts })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PackCharts)->ArgsProduct({ mesh_kinds, faces_counts, { 0, 1, 2, 3, 4 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+// Brute force placement is much slower, so only run it on the smallest meshes
+BENCHMARK(BM_PackCharts)->ArgsProduct({ mesh_kinds, { 1 << 12 }, { 5 } })->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,660 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "Face.h"
+#include "TaskExecutor.h"
+#include "UVCoord.h"
+#include "UnwrapOptions.h"
+#include "UnwrapResult.h"
+#include "Vertex.h"
+#include "procedural_meshes.h"
+#include "unwrap.h"
+
+/*
+ * Regression harness of the packing quality and throughput. It unwraps a corpus of procedural meshes, measures each result and compares the measurements
+ * against a baseline file, failing when one of them got worse by more than a tolerance. The baseline is rewritten with --update, once a change of the
+ * results has been accepted. It also checks that the unwrapping completes when run from the threads of the executor it uses, as when embedded in the pool
+ * of a host application.
+ */
+
+struct CorpusEntry
+{
+    MeshKind kind;
+    size_t faces_count;
+};
+
+static constexpr std::array corpus{ CorpusEntry{ MeshKind::Sphere, 1 << 12 },  CorpusEntry{ MeshKind::Sphere, 1 << 15 }, CorpusEntry{ MeshKind::Terrain, 1 << 12 },
+                                    CorpusEntry{ MeshKind::Terrain, 1 << 15 }, CorpusEntry{ MeshKind::Boxes, 1 << 12 },  CorpusEntry{ MeshKind::Boxes, 1 << 15 },
+                                    CorpusEntry{ MeshKind::Shells, 1 << 12 },  CorpusEntry{ MeshKind::Shells, 1 << 15 } };
+
+struct Metrics
+{
+    double time_ms{ 0.0 }; // Best wall time of the unwrapping over the repetitions
+    double peak_memory{ 0.0 }; // Peak amount of temporary memory used by the unwrapping, in bytes
+    double charts_count{ 0.0 };
+    double utilization{ 0.0 }; // Fraction of the atlas covered by charts
+    double texture_width{ 0.0 };
+    double texture_height{ 0.0 };
+    double texel_density{ 0.0 }; // Average number of texels per unit of length of the mesh, in the output texture
+    double overlapping_faces{ 0.0 }; // Number of faces whose UV triangle overlaps another one
+};
+
+/*!
+ * Description of how a metric is compared against its baseline
+ */
+struct MetricCheck
+{
+    const char* name;
+    double Metrics::*value;
+    bool higher_is_better;
+    bool timing; // Whether the metric depends on the machine and its load, so that it is only checked on request, with a larger tolerance
+};
+
+static constexpr std::array metric_checks{ MetricCheck{ "time_ms", &Metrics::time_ms, false, true },
+                                           MetricCheck{ "peak_memory", &Metrics::peak_memory, false, false },
+                                           MetricCheck{ "charts_count", &Metrics::charts_count, false, false },
+                                           MetricCheck{ "utilization", &Metrics::utilization, true, false },
+                                           MetricCheck{ "texture_width", &Metrics::texture_width, false, false },
+                                           MetricCheck{ "texture_height", &Metrics::texture_height, false, false },
+                                           MetricCheck{ "texel_density", &Metrics::texel_density, true, false },
+                                           MetricCheck{ "overlapping_faces", &Metrics::overlapping_faces, false, false } };
+
+static std::string entryName(const CorpusEntry& entry)
+{
+    return std::string(mesh_kind_names[static_cast<size_t>(entry.kind)]) + "/" + std::to_string(entry.faces_count);
+}
+
+static double cross(const UVCoord& origin, const UVCoord& a, const UVCoord& b)
+{
+    return static_cast<double>(a.u - origin.u) * static_cast<double>(b.v - origin.v) - static_cast<double>(a.v - origin.v) * static_cast<double>(b.u - origin.u);
+}
+
+/*!
+ * Checks whether the interiors of two triangles overlap, using the separating axis theorem
+ * @param a The first triangle
+ * @param b The second triangle
+ * @param epsilon Overlaps thinner than this are ignored, so that triangles touching by an edge or a vertex don't overlap
+ * @return True if the triangles overlap
+ */
+static bool trianglesOverlap(const std::array<UVCoord, 3>& a, const std::array<UVCoord, 3>& b, double epsilon)
+{
+    for (const std::array<UVCoord, 3>* triangle : { &a, &b })
+    {
+        for (size_t edge = 0; edge < 3; ++edge)
+        {
+            const UVCoord& start = (*triangle)[edge];
+            const UVCoord& end = (*triangle)[(edge + 1) % 3];
+            const double axis_u = static_cast<double>(start.v) - static_cast<double>(end.v);
+            const double axis_v = static_cast<double>(end.u) - static_cast<double>(start.u);
+            const double length = std::sqrt(axis_u * axis_u + axis_v * axis_v);
+            if (length == 0.0)
+            {
+                continue;
+            }
+
+            const auto project = [&](const std::array<UVCoord, 3>& points)
+            {
+                double min = std::numeric_limits<double>::max();
+                double max = std::numeric_limits<double>::lowest();
+                for (const UVCoord& point : points)
+                {
+                    const double projection = (static_cast<double>(point.u) * axis_u + static_cast<double>(point.v) * axis_v) / length;
+                    min = std::min(min, projection);
+                    max = std::max(max, projection);
+                }
+                return std::make_pair(min, max);
+            };
+            const auto [min_a, max_a] = project(a);
+            const auto [min_b, max_b] = project(b);
+            if (std::min(max_a, max_b) - std::max(min_a, min_b) <= epsilon)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * Counts the faces whose UV triangle overlaps the one of another face, in texels. The faces are sorted in a grid, so that only the faces sharing a cell
+ * are compared.
+ */
+static size_t countOverlappingFaces(const UnwrapResult& result)
+{
+    const auto width = static_cast<float>(result.texture_width);
+    const auto height = static_cast<float>(result.texture_height);
+    std::vector<std::array<UVCoord, 3>> triangles;
+    triangles.reserve(result.faces.size());
+    for (const Face& face : result.faces)
+    {
+        std::array<UVCoord, 3> triangle;
+        size_t corner = 0;
+        for (const uint32_t index : { face.i1, face.i2, face.i3 })
+        {
+            triangle[corner++] = UVCoord{ .u = result.uv_coords[index].u * width, .v = result.uv_coords[index].v * height };
+        }
+        triangles.push_back(triangle);
+    }
+
+    const auto grid_size = std::max(static_cast<size_t>(std::sqrt(static_cast<double>(triangles.size()))), size_t(1));
+    const auto cell = [&](float coordinate, float size)
+    {
+        return std::min(static_cast<size_t>(std::max(coordinate / size * static_cast<float>(grid_size), 0.0F)), grid_size - 1);
+    };
+
+    std::vector<std::vector<uint32_t>> cells(grid_size * grid_size);
+    for (size_t index = 0; index < triangles.size(); ++index)
+    {
+        const std::array<UVCoord, 3>& triangle = triangles[index];
+        if (std::abs(cross(triangle[0], triangle[1], triangle[2])) <= 1e-9)
+        {
+            continue;
+        }
+
+        const auto [min_u, max_u] = std::minmax({ triangle[0].u, triangle[1].u, triangle[2].u });
+        const auto [min_v, max_v] = std::minmax({ triangle[0].v, triangle[1].v, triangle[2].v });
+        for (size_t y = cell(min_v, height); y <= cell(max_v, height); ++y)
+        {
+            for (size_t x = cell(min_u, width); x <= cell(max_u, width); ++x)
+            {
+                cells[y * grid_size + x].push_back(static_cast<uint32_t>(index));
+            }
+        }
+    }
+
+    std::vector<bool> overlapping(triangles.size(), false);
+    for (const std::vector<uint32_t>& faces : cells)
+    {
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            for (size_t j = i + 1; j < faces.size(); ++j)
+            {
+                if ((! overlapping[faces[i]] || ! overlapping[faces[j]]) && trianglesOverlap(triangles[faces[i]], triangles[faces[j]], 1e-3))
+                {
+                    overlapping[faces[i]] = true;
+                    overlapping[faces[j]] = true;
+                }
+            }
+        }
+    }
+
+    return static_cast<size_t>(std::count(overlapping.begin(), overlapping.end(), true));
+}
+
+/*!
+ * @return The average number of texels per unit of length of the mesh, in the output texture
+ */
+static double texelDensity(const BenchMesh& mesh, const UnwrapResult& result)
+{
+    double mesh_area = 0.0;
+    double texture_area = 0.0;
+    for (size_t index = 0; index < mesh.faces.size(); ++index)
+    {
+        const Face& face = mesh.faces[index];
+        const Vertex& v1 = mesh.vertices[face.i1];
+        const Vertex& v2 = mesh.vertices[face.i2];
+        const Vertex& v3 = mesh.vertices[face.i3];
+        const double ax = v2.x - v1.x;
+        const double ay = v2.y - v1.y;
+        const double az = v2.z - v1.z;
+        const double bx = v3.x - v1.x;
+        const double by = v3.y - v1.y;
+        const double bz = v3.z - v1.z;
+        const double nx = ay * bz - az * by;
+        const double ny = az * bx - ax * bz;
+        const double nz = ax * by - ay * bx;
+        mesh_area += std::sqrt(nx * nx + ny * ny + nz * nz) / 2.0;
+
+        const Face& uv_face = result.faces[index];
+        texture_area += std::abs(cross(result.uv_coords[uv_face.i1], result.uv_coords[uv_face.i2], result.uv_coords[uv_face.i3])) / 2.0;
+    }
+
+    texture_area *= static_cast<double>(result.texture_width) * static_cast<double>(result.texture_height);
+    return mesh_area > 0.0 ? std::sqrt(texture_area / mesh_area) : 0.0;
+}
+
+static bool measure(const CorpusEntry& entry, uint32_t repetitions, uint32_t thread_count, Metrics& metrics)
+{
+    const BenchMesh mesh = makeMesh(entry.kind, entry.faces_count);
+    UnwrapOptions options;
+    options.thread_count = thread_count;
+    options.track_memory = true;
+
+    UnwrapResult result;
+    metrics.time_ms = std::numeric_limits<double>::max();
+    for (uint32_t repetition = 0; repetition < repetitions; ++repetition)
+    {
+        result = UnwrapResult{};
+        const auto start = std::chrono::steady_clock::now();
+        if (! smartUnwrap(mesh.vertices, mesh.faces, result, options))
+        {
+            spdlog::error("Unwrapping of {} failed", entryName(entry));
+            return false;
+        }
+        metrics.time_ms = std::min(metrics.time_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    metrics.peak_memory = static_cast<double>(result.stats.peak_memory);
+    metrics.charts_count = result.stats.charts_count;
+    metrics.utilization = result.stats.utilization;
+    metrics.texture_width = result.texture_width;
+    metrics.texture_height = result.texture_height;
+    metrics.texel_density = texelDensity(mesh, result);
+    metrics.overlapping_faces = static_cast<double>(countOverlappingFaces(result));
+    return true;
+}
+
+/*!
+ * Loads a baseline file, made of a line per corpus entry with its name followed by the value of each metric, in the order of metric_checks
+ * @return True if the file could be read
+ */
+static bool loadBaseline(const std::string& file_path, std::map<std::string, Metrics>& baseline)
+{
+    std::ifstream file(file_path);
+    if (! file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        std::string name;
+        Metrics metrics;
+        stream >> name;
+        for (const MetricCheck& check : metric_checks)
+        {
+            stream >> metrics.*check.value;
+        }
+        if (! stream)
+        {
+            spdlog::warn("Ignoring invalid baseline line: {}", line);
+            continue;
+        }
+        baseline[name] = metrics;
+    }
+
+    return true;
+}
+
+static bool saveBaseline(const std::string& file_path, const std::vector<std::pair<std::string, Metrics>>& measurements)
+{
+    std::ofstream file(file_path);
+    file << "# Regression baseline of uvula_regression, rewritten by running it with --update\n#";
+    file << std::setprecision(10);
+    for (const MetricCheck& check : metric_checks)
+    {
+        file << ' ' << check.name;
+    }
+    file << '\n';
+
+    for (const auto& [name, metrics] : measurements)
+    {
+        file << name;
+        for (const MetricCheck& check : metric_checks)
+        {
+            file << ' ' << metrics.*check.value;
+        }
+        file << '\n';
+    }
+
+    return static_cast<bool>(file);
+}
+
+/*!
+ * Compares the metrics of an entry against its baseline, and reports the differences
+ * @param time_tolerance The relative tolerance of the timings, or nothing to leave them unchecked
+ * @return The number of regressions, i.e. metrics that got worse by more than their tolerance
+ */
+static size_t compare(const std::string& name, const Metrics& metrics, const Metrics& baseline, double tolerance, std::optional<double> time_tolerance)
+{
+    size_t regressions = 0;
+    for (const MetricCheck& check : metric_checks)
+    {
+        if (check.timing && ! time_tolerance.has_value())
+        {
+            continue;
+        }
+
+        const double value = metrics.*check.value;
+        const double reference = baseline.*check.value;
+        const double allowed = std::abs(reference) * (check.timing ? *time_tolerance : tolerance);
+        const double worsening = check.higher_is_better ? reference - value : value - reference;
+        if (worsening > allowed)
+        {
+            spdlog::error("{}: {} regressed from {:.6g} to {:.6g}", name, check.name, reference, value);
+            ++regressions;
+        }
+        else if (-worsening > allowed && -worsening > 0.0)
+        {
+            spdlog::info("{}: {} improved from {:.6g} to {:.6g}", name, check.name, reference, value);
+        }
+    }
+
+    return regressions;
+}
+
+/*!
+ * Minimal thread pool, standing for the pool of a host application that the unwrapping runs in
+ */
+class ThreadPoolExecutor : public TaskExecutor
+{
+public:
+    explicit ThreadPoolExecutor(uint32_t thread_count)
+    {
+        for (uint32_t index = 0; index < thread_count; ++index)
+        {
+            threads_.emplace_back(
+                [this]()
+                {
+                    while (true)
+                    {
+                        std::unique_lock lock(mutex_);
+                        condition_.wait(
+                            lock,
+                            [this]()
+                            {
+                                return stopping_ || ! jobs_.empty();
+                            });
+                        if (jobs_.empty())
+                        {
+                            return;
+                        }
+                        const auto [function, user_data] = jobs_.front();
+                        jobs_.erase(jobs_.begin());
+                        lock.unlock();
+                        function(user_data);
+                    }
+                });
+        }
+    }
+
+    ~ThreadPoolExecutor() override
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        for (std::thread& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]] uint32_t concurrency() const override
+    {
+        return static_cast<uint32_t>(threads_.size());
+    }
+
+    void execute(void (*function)(void* user_data), void* user_data) override
+    {
+        {
+            std::lock_guard lock(mutex_);
+            jobs_.emplace_back(function, user_data);
+        }
+        condition_.notify_one();
+    }
+
+private:
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<std::pair<void (*)(void*), void*>> jobs_;
+    bool stopping_{ false };
+};
+
+/*!
+ * Unwraps a mesh from each thread of an executor, using that same executor, which is how the unwrapping is embedded in the pool of a host application.
+ * The jobs of the unwrapping are then queued behind the busy threads, and must not be waited for.
+ * @return True if all the unwrappings completed in time, with the same result as on the threads of the library
+ */
+static bool checkNestedExecutor()
+{
+    const BenchMesh mesh = makeMesh(MeshKind::Sphere, 1 << 12);
+    UnwrapResult reference;
+    if (! smartUnwrap(mesh.vertices, mesh.faces, reference))
+    {
+        spdlog::error("Unwrapping of the executor check mesh failed");
+        return false;
+    }
+
+    for (const uint32_t thread_count : { 1U, 2U })
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        uint32_t completed = 0;
+        bool matching = true;
+        struct Job
+        {
+            const BenchMesh* mesh;
+            ThreadPoolExecutor* executor;
+            uint64_t expected_hash;
+            std::function<void(bool)> done;
+        };
+
+        const std::function<void(bool)> done = [&](bool succeeded)
+        {
+            std::lock_guard lock(mutex);
+            ++completed;
+            matching = matching && succeeded;
+            condition.notify_all();
+        };
+
+        // The jobs are declared before the executor, so that its threads are joined before the jobs are destroyed
+        std::vector<Job> jobs;
+        ThreadPoolExecutor executor(thread_count);
+        jobs.assign(thread_count, Job{ .mesh = &mesh, .executor = &executor, .expected_hash = reference.uv_hash, .done = done });
+        for (Job& job : jobs)
+        {
+            executor.execute(
+                [](void* user_data)
+                {
+                    Job& job = *static_cast<Job*>(user_data);
+                    UnwrapOptions options;
+                    options.executor = job.executor;
+                    UnwrapResult result;
+                    job.done(smartUnwrap(job.mesh->vertices, job.mesh->faces, result, options) && result.uv_hash == job.expected_hash);
+                },
+                &job);
+        }
+
+        std::unique_lock lock(mutex);
+        const bool in_time = condition.wait_for(
+            lock,
+            std::chrono::seconds(60),
+            [&]()
+            {
+                return completed == thread_count;
+            });
+        lock.unlock();
+        if (! in_time)
+        {
+            // The threads of the pool are stuck, and can not be joined
+            spdlog::error("Unwrapping from the threads of an executor of {} threads, on that executor, did not complete", thread_count);
+            std::fflush(nullptr);
+            std::_Exit(1);
+        }
+        if (! matching)
+        {
+            spdlog::error("Unwrapping from the threads of an executor of {} threads, on that executor, gave a different result", thread_count);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void printUsage()
+{
+    std::puts(
+        "Usage: uvula_regression [options] [baseline]\n"
+        "Unwraps a corpus of procedural meshes and compares the results against a baseline file\n"
+        "  --update              Write the measurements to the baseline file instead of comparing them\n"
+        "  --tolerance <f>       Relative tolerance of the quality and memory metrics (default 0.01)\n"
+        "  --check-time          Also compare the timings, which are only meaningful against a baseline written on the same machine\n"
+        "  --time-tolerance <f>  Relative tolerance of the timings, with --check-time (default 0.5)\n"
+        "  --repetitions <n>     Number of unwrappings of each mesh, of which the fastest is kept (default 3)\n"
+        "  -j, --threads <n>     Number of threads to be used, by default all the CPUs available to the process\n"
+        "  -h, --help            Print this help and exit");
+}
+
+int main(int argc, char** argv)
+{
+    std::string baseline_path = UVULA_REGRESSION_BASELINE;
+    bool update = false;
+    double tolerance = 0.01;
+    bool check_time = false;
+    double time_tolerance = 0.5;
+    uint32_t repetitions = 3;
+    uint32_t thread_count = 0;
+
+    for (int index = 1; index < argc; ++index)
+    {
+        const std::string_view argument = argv[index];
+        const auto next_value = [&]() -> const char*
+        {
+            if (index + 1 >= argc)
+            {
+                spdlog::error("Missing value for {}", argument);
+                std::exit(2);
+            }
+            return argv[++index];
+        };
+
+        if (argument == "-h" || argument == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        else if (argument == "--update")
+        {
+            update = true;
+        }
+        else if (argument == "--tolerance")
+        {
+            tolerance = std::atof(next_value());
+        }
+        else if (argument == "--check-time")
+        {
+            check_time = true;
+        }
+        else if (argument == "--time-tolerance")
+        {
+            time_tolerance = std::atof(next_value());
+        }
+        else if (argument == "--repetitions")
+        {
+            repetitions = std::max(std::atoi(next_value()), 1);
+        }
+        else if (argument == "-j" || argument == "--threads")
+        {
+            thread_count = static_cast<uint32_t>(std::max(std::atoi(next_value()), 0));
+        }
+        else if (argument.starts_with('-'))
+        {
+            spdlog::error("Unknown option {}", argument);
+            printUsage();
+            return 2;
+        }
+        else
+        {
+            baseline_path = argument;
+        }
+    }
+
+    std::map<std::string, Metrics> baseline;
+    if (! update && ! loadBaseline(baseline_path, baseline))
+    {
+        spdlog::error("Unable to read the baseline file {}, it can be created with --update", baseline_path);
+        return 2;
+    }
+
+    std::vector<std::pair<std::string, Metrics>> measurements;
+    size_t regressions = 0;
+    bool failed = ! checkNestedExecutor();
+    std::printf("%-16s %10s %12s %8s %11s %11s %13s %8s\n", "mesh", "time (ms)", "memory (KiB)", "charts", "utilization", "texture", "texel density", "overlaps");
+    for (const CorpusEntry& entry : corpus)
+    {
+        const std::string name = entryName(entry);
+        Metrics metrics;
+        if (! measure(entry, repetitions, thread_count, metrics))
+        {
+            failed = true;
+            continue;
+        }
+
+        std::printf(
+            "%-16s %10.1f %12.0f %8.0f %10.2f%% %5.0fx%-5.0f %13.3f %8.0f\n",
+            name.c_str(),
+            metrics.time_ms,
+            metrics.peak_memory / 1024.0,
+            metrics.charts_count,
+            metrics.utilization * 100.0,
+            metrics.texture_width,
+            metrics.texture_height,
+            metrics.texel_density,
+            metrics.overlapping_faces);
+        measurements.emplace_back(name, metrics);
+
+        if (! update)
+        {
+            const auto iterator = baseline.find(name);
+            if (iterator == baseline.end())
+            {
+                spdlog::warn("{} has no baseline, it can be added with --update", name);
+                continue;
+            }
+            regressions += compare(name, metrics, iterator->second, tolerance, check_time ? std::optional(time_tolerance) : std::nullopt);
+        }
+    }
+
+    if (update)
+    {
+        if (failed || ! saveBaseline(baseline_path, measurements))
+        {
+            spdlog::error("The baseline file {} was not updated", baseline_path);
+            return 1;
+        }
+        spdlog::info("Baseline written to {}", baseline_path);
+        return 0;
+    }
+
+    if (failed || regressions > 0)
+    {
+        spdlog::error("{} regressions found", regressions);
+        return 1;
+    }
+
+    spdlog::info("No regression found");
+    return 0;
+}
@@ -0,0 +1,70 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include <benchmark/benchmark.h>
+
+#include "../src/xatlas.cpp"
+
+using xatlas::internal::KISSRng;
+using xatlas::internal::segment::CostQueue;
+
+/*!
+ * Push random costs then pop all of them, which is the typical usage pattern when growing charts by cost
+ * @param state.range(0) The number of elements to be pushed
+ * @param state.range(1) The maximum size of the queue, or 0 for unbounded
+ */
+static void BM_CostQueuePushPop(benchmark::State& state)
+{
+    const auto count = static_cast<uint32_t>(state.range(0));
+    const auto max_size = state.range(1) > 0 ? static_cast<uint32_t>(state.range(1)) : UINT32_MAX;
+
+    KISSRng rand;
+    xatlas::internal::Array<float> costs;
+    costs.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        costs[i] = static_cast<float>(rand.getRange(1 << 20)) / static_cast<float>(1 << 20);
+    }
+
+    for (auto _ : state)
+    {
+        CostQueue queue(max_size);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            queue.push(costs[i], i);
+        }
+        while (queue.count() > 0)
+        {
+            benchmark::DoNotOptimize(queue.pop());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetComplexityN(count);
+}
+BENCHMARK(BM_CostQueuePushPop)->ArgsProduct({ benchmark::CreateRange(1 << 8, 1 << 18, 4), { 0 } })->Complexity(benchmark::oNLogN);
+BENCHMARK(BM_CostQueuePushPop)->ArgsProduct({ benchmark::CreateRange(1 << 8, 1 << 18, 4), { 256 } });
+
+/*!
+ * Interleave pushes and pops, like when the best face is consumed right after its neighbours have been queued
+ * @param state.range(0) The number of elements to be pushed
+ */
+static void BM_CostQueueInterleaved(benchmark::State& state)
+{
+    const auto count = static_cast<uint32_t>(state.range(0));
+
+    for (auto _ : state)
+    {
+        KISSRng rand;
+        CostQueue queue;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            queue.push(static_cast<float>(rand.getRange(1 << 20)), i);
+            queue.push(static_cast<float>(rand.getRange(1 << 20)), i);
+            benchmark::DoNotOptimize(queue.pop());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetComplexityN(count);
+}
+BENCHMARK(BM_CostQueueInterleaved)->RangeMultiplier(4)->Range(1 << 8, 1 << 18)->Complexity(benchmark::oNLogN);
@@ -1,48 +1,376 @@
 ﻿// (c) 2025, UltiMaker -- see LICENCE for details
 
+#include <array>
+#include <cctype>
 #include <assimp/Exporter.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/SceneCombiner.h>
 #include <assimp/mesh.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cxxopts.hpp>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/stopwatch.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 #include "Face.h"
+#include "MeshView.h"
 #include "UVCoord.h"
+#include "UnwrapCache.h"
+#include "UnwrapOptions.h"
+#include "UnwrapPool.h"
+#include "UnwrapResult.h"
+#include "UnwrapStage.h"
 #include "Vertex.h"
+#include "mesh_io.h"
+#include "raw_files.h"
 #include "unwrap.h"
+#include "xatlas.h"
 
-int main(int argc, char** argv)
+/*!
+ * Time spent in each step of the processing of a file, from its loading to its export, accumulated over its meshes
+ */
+struct Profile
 {
-    cxxopts::Options options("Uvula", "Test interface for the libuvula library");
-    options.add_options()("filepath", "Path of the 3D mesh file to be loaded (OBJ, STL, ...)", cxxopts::value<std::string>())(
-        "o,outputfile",
-        "Path of the output 3D mesh with UV coordinates (OBJ)",
-        cxxopts::value<std::string>())("d,debug", "Display debug output")("h,help", "Print this help and exit");
-    options.parse_positional({ "filepath" });
-    options.positional_help("<filepath>");
-    options.show_positional_help();
+    std::chrono::steady_clock::duration load{};
+    std::chrono::steady_clock::duration unwrap{}; // Whole time of the unwrapping calls, including the stages
+    std::array<std::chrono::steady_clock::duration, unwrap_stage_count> stages{};
+    std::chrono::steady_clock::duration export_duration{};
+    size_t vertices_count{ 0 };
+    size_t faces_count{ 0 };
+    uint32_t charts_count{ 0 };
+};
 
-    cxxopts::ParseResult result = options.parse(argc, argv);
-    if (result.count("help") || ! result.count("filepath"))
+/*!
+ * Unwraps a mesh and displays the statistics requested on the command line
+ * @param vertices The positions of the vertices
+ * @param faces The faces of the mesh
+ * @param result The parsed command line
+ * @param cache The cache of unwrapping results, if any
+ * @param unwrap_result The result of the unwrapping
+ * @param profile The profile the unwrapping is added to, if profiling
+ * @return True if the unwrapping succeeded
+ */
+static bool unwrapMesh(
+    std::span<const Vertex> vertices,
+    std::span<const Face> faces,
+    const cxxopts::ParseResult& result,
+    std::optional<UnwrapCache>& cache,
+    UnwrapResult& unwrap_result,
+    Profile* profile)
+{
+    UnwrapOptions unwrap_options;
+    unwrap_options.track_memory = result.count("memory") > 0;
+    if (result.count("threads"))
     {
-        std::cout << options.help() << std::endl;
-        return 0;
+        unwrap_options.thread_count = result["threads"].as<uint32_t>();
+    }
+    unwrap_options.pin_threads = result.count("pin") > 0;
+    unwrap_options.create_image = result.count("atlas-images") > 0;
+    std::array<std::chrono::steady_clock::duration, unwrap_stage_count> stage_durations{};
+    if (result.count("timings") || profile != nullptr)
+    {
+        unwrap_options.timing_callback = [&stage_durations](UnwrapStage stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+        {
+            stage_durations[static_cast<size_t>(stage)] += end - start;
+        };
     }
 
-    if (result.count("debug"))
+    if (unwrap_options.track_memory)
     {
-        spdlog::set_level(spdlog::level::debug);
+        spdlog::info("Estimated peak memory usage is {:.1f}MB", estimateUnwrapMemory(vertices.size(), faces.size()) / 1.0e6);
     }
 
-    const std::string file_path = result["filepath"].as<std::string>();
-    spdlog::info("Loading mesh from {}", file_path);
+    spdlog::stopwatch timer;
+
+    spdlog::info("Start UV unwrapping");
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (! (cache.has_value() ? cache->smartUnwrap(vertices, faces, unwrap_result, unwrap_options) : smartUnwrap(vertices, faces, unwrap_result, unwrap_options)))
+    {
+        spdlog::error("Couldn't unwrap UVs!");
+        return false;
+    }
+    if (profile != nullptr)
+    {
+        profile->unwrap += std::chrono::steady_clock::now() - start;
+        for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+        {
+            profile->stages[stage] += unwrap_result.stats.stage_durations[stage];
+        }
+        profile->vertices_count += vertices.size();
+        profile->faces_count += faces.size();
+        profile->charts_count += unwrap_result.stats.charts_count;
+    }
+
+    if (unwrap_result.stats.from_cache)
+    {
+        spdlog::info("Loaded the UV unwrapping from the cache");
+    }
+    spdlog::info("Suggested texture size is {}x{}", unwrap_result.texture_width, unwrap_result.texture_height);
+    spdlog::info("UV unwrapping took {}ms", timer.elapsed_ms().count());
+    if (result.count("timings"))
+    {
+        for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+        {
+            const std::chrono::duration<double, std::milli> duration = stage_durations[stage];
+            spdlog::info("    {}: {:.1f}ms", unwrapStageName(static_cast<UnwrapStage>(stage)), duration.count());
+        }
+    }
+    if (unwrap_options.track_memory)
+    {
+        spdlog::info("Peak memory usage was {:.1f}MB", unwrap_result.stats.peak_memory / 1.0e6);
+        for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+        {
+            spdlog::info("    {}: {:.1f}MB", unwrapStageName(static_cast<UnwrapStage>(stage)), unwrap_result.stats.stage_peak_memory[stage] / 1.0e6);
+        }
+    }
+    for (size_t thread_index = 0; thread_index < unwrap_result.stats.workers.size(); ++thread_index)
+    {
+        const WorkerStats& worker = unwrap_result.stats.workers[thread_index];
+        spdlog::debug(
+            "Thread {}: {} tasks executed, {} stolen, {}",
+            thread_index,
+            worker.executed_tasks,
+            worker.stolen_tasks,
+            worker.cpu >= 0 ? fmt::format("pinned to CPU {}", worker.cpu) : std::string("not pinned"));
+    }
+    if (unwrap_result.uv_coords.size() != vertices.size())
+    {
+        spdlog::info("{} vertices have been split on charts seams", unwrap_result.uv_coords.size() - vertices.size());
+    }
+
+    return true;
+}
+
+/*! @return Whether the output file should hold raw UV coordinates, rather than a mesh */
+static bool isRawUvsFile(const std::filesystem::path& path)
+{
+    return path.extension() == ".uvu";
+}
+
+/*!
+ * Writes the UV coordinates of a mesh to a raw UV file
+ * @param output_file The path of the file. If the input file has several meshes, their index is added to it.
+ * @param mesh_index The index of the mesh in the input file
+ * @param meshes_count The number of meshes of the input file
+ * @param unwrap_result The result of the unwrapping of the mesh
+ * @return True if the file could be written
+ */
+static bool writeRawUvs(std::filesystem::path output_file, size_t mesh_index, size_t meshes_count, const UnwrapResult& unwrap_result)
+{
+    if (meshes_count > 1)
+    {
+        output_file.replace_extension(fmt::format("{}.uvu", mesh_index));
+    }
+    spdlog::info("Exporting UV coordinates to {}", output_file.string());
+    if (! raw_files::writeUvs(output_file, unwrap_result.texture_width, unwrap_result.texture_height, unwrap_result.uv_coords, unwrap_result.faces))
+    {
+        spdlog::error("Unable to write {}", output_file.string());
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Writes the atlas images of a mesh as binary PGM files, upscaled to the texture size: an 8 bits mask, where the texels covered by a chart are 255, the
+ * ones only sampled by bilinear filtering 128, the padding 64 and the empty texels 0, and a 16 bits image of the chart covering each texel, as its index
+ * plus 1, wrapping after 65535 charts, or 0 when empty. Rows are in order of increasing V.
+ * @param prefix The prefix of the paths of the images, completed with "_mask.pgm" and "_charts.pgm". If the input file has several meshes, their index is
+ *               added to it.
+ * @param mesh_index The index of the mesh in the input file
+ * @param meshes_count The number of meshes of the input file
+ * @param unwrap_result The result of the unwrapping of the mesh, made with UnwrapOptions::create_image
+ * @return True if the files could be written
+ */
+static bool writeAtlasImages(const std::string& prefix, size_t mesh_index, size_t meshes_count, const UnwrapResult& unwrap_result)
+{
+    const uint32_t atlas_width = unwrap_result.stats.atlas_width;
+    const uint32_t atlas_height = unwrap_result.stats.atlas_height;
+    const uint32_t width = unwrap_result.texture_width;
+    const uint32_t height = unwrap_result.texture_height;
+    if (unwrap_result.atlas_image.size() != static_cast<size_t>(atlas_width) * atlas_height || width == 0 || height == 0)
+    {
+        spdlog::error("No atlas image was made for the mesh");
+        return false;
+    }
+
+    // Nearest texel of the atlas for each column of the texture, the rows being mapped likewise
+    std::vector<uint32_t> atlas_columns(width);
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        atlas_columns[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * atlas_width / width);
+    }
+
+    std::vector<uint8_t> mask_row(width);
+    std::vector<uint8_t> charts_row(width * 2);
+    const std::string file_prefix = meshes_count > 1 ? fmt::format("{}.{}", prefix, mesh_index) : prefix;
+    const std::filesystem::path mask_path = file_prefix + "_mask.pgm";
+    const std::filesystem::path charts_path = file_prefix + "_charts.pgm";
+    spdlog::info("Exporting atlas images to {} and {}", mask_path.string(), charts_path.string());
+    std::ofstream mask_file(mask_path, std::ios::binary);
+    std::ofstream charts_file(charts_path, std::ios::binary);
+    mask_file << fmt::format("P5\n{} {}\n255\n", width, height);
+    charts_file << fmt::format("P5\n{} {}\n65535\n", width, height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint32_t* atlas_row = &unwrap_result.atlas_image[static_cast<uint64_t>(y) * atlas_height / height * atlas_width];
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t texel = atlas_row[atlas_columns[x]];
+            uint8_t coverage = 0;
+            uint16_t chart = 0;
+            if (texel & xatlas::kImageHasChartIndexBit)
+            {
+                coverage = (texel & xatlas::kImageIsPaddingBit) ? 64 : (texel & xatlas::kImageIsBilinearBit) ? 128 : 255;
+                chart = static_cast<uint16_t>((texel & xatlas::kImageChartIndexMask) % 65535 + 1);
+            }
+            mask_row[x] = coverage;
+            // 16 bits PGM samples are big-endian
+            charts_row[x * 2] = static_cast<uint8_t>(chart >> 8);
+            charts_row[x * 2 + 1] = static_cast<uint8_t>(chart & 0xFF);
+        }
+        mask_file.write(reinterpret_cast<const char*>(mask_row.data()), static_cast<std::streamsize>(mask_row.size()));
+        charts_file.write(reinterpret_cast<const char*>(charts_row.data()), static_cast<std::streamsize>(charts_row.size()));
+    }
+
+    if (! mask_file || ! charts_file)
+    {
+        spdlog::error("Unable to write {} or {}", mask_path.string(), charts_path.string());
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Unwraps a mesh file loaded by one of the fast paths, and exports the result
+ * @param mesh The loaded mesh
+ * @param output_file The path of the output file, if any
+ * @param result The parsed command line
+ * @param cache The cache of unwrapping results, if any
+ * @param profile The profile of the file, if profiling
+ * @return True if the mesh was unwrapped and exported
+ */
+static bool processLoadedMesh(
+    const mesh_io::LoadedMesh& mesh,
+    const std::optional<std::filesystem::path>& output_file,
+    const cxxopts::ParseResult& result,
+    std::optional<UnwrapCache>& cache,
+    Profile* profile)
+{
+    spdlog::info("Loaded mesh with {} vertices and {} faces", mesh.vertices.size(), mesh.faces.size());
+
+    UnwrapResult unwrap_result;
+    if (! unwrapMesh(mesh.vertices, mesh.faces, result, cache, unwrap_result, profile))
+    {
+        return false;
+    }
+
+    const std::chrono::steady_clock::time_point export_start = std::chrono::steady_clock::now();
+    bool written = true;
+    if (result.count("atlas-images"))
+    {
+        written = writeAtlasImages(result["atlas-images"].as<std::string>(), 0, 1, unwrap_result);
+    }
+
+    if (! output_file.has_value())
+    {
+        if (profile != nullptr)
+        {
+            profile->export_duration += std::chrono::steady_clock::now() - export_start;
+        }
+        return written;
+    }
+
+    if (isRawUvsFile(*output_file))
+    {
+        written = writeRawUvs(*output_file, 0, 1, unwrap_result) && written;
+    }
+    else
+    {
+        spdlog::info("Exporting result to {}", output_file->string());
+        if (! mesh_io::writeObj(*output_file, mesh.vertices, unwrap_result))
+        {
+            spdlog::error("Unable to write {}", output_file->string());
+            written = false;
+        }
+    }
+    if (profile != nullptr)
+    {
+        profile->export_duration += std::chrono::steady_clock::now() - export_start;
+    }
+    return written;
+}
+
+/*!
+ * Copies the vertices and faces of a mesh loaded by Assimp
+ * @param mesh The loaded mesh
+ * @param vertices The positions of the vertices
+ * @param indices The faces of the mesh
+ */
+static void convertMesh(const aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<Face>& indices)
+{
+    vertices.reserve(mesh->mNumVertices);
+    for (size_t j = 0; j < mesh->mNumVertices; j++)
+    {
+        const aiVector3D vertex = mesh->mVertices[j];
+        vertices.emplace_back(vertex.x, vertex.y, vertex.z);
+    }
+
+    indices.reserve(mesh->mNumFaces);
+    for (size_t j = 0; j < mesh->mNumFaces; j++)
+    {
+        const aiFace& face = mesh->mFaces[j];
+        indices.emplace_back(face.mIndices[0], face.mIndices[1], face.mIndices[2]);
+    }
+}
+
+/*!
+ * Unwraps all the meshes of a file loaded by Assimp, and exports the result
+ * @param file_path The path of the mesh file
+ * @param output_file The path of the output file, if any
+ * @param result The parsed command line
+ * @param cache The cache of unwrapping results, if any
+ * @param profile The profile of the file, if profiling
+ * @return True if the meshes were unwrapped and exported
+ */
+static bool processAssimpFile(
+    const std::string& file_path,
+    const std::optional<std::filesystem::path>& output_file,
+    const cxxopts::ParseResult& result,
+    std::optional<UnwrapCache>& cache,
+    Profile* profile)
+{
+    // The profile times the loading of the meshes, including their conversion, and their export, including the copy of the scene
+    std::chrono::steady_clock::time_point step_start = std::chrono::steady_clock::now();
+    const auto end_step = [profile, &step_start](std::chrono::steady_clock::duration Profile::*step)
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (profile != nullptr)
+        {
+            profile->*step += now - step_start;
+        }
+        step_start = now;
+    };
 
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(file_path, 0);
@@ -50,7 +378,7 @@ int main(int argc, char** argv)
     if (! scene)
     {
         spdlog::error("Failed to load mesh: {}", importer.GetErrorString());
-        return 1;
+        return false;
     }
 
     if (scene->HasMeshes())
@@ -66,12 +394,15 @@ int main(int argc, char** argv)
         spdlog::warn("The file doesn't contain any mesh");
     }
 
+    end_step(&Profile::load);
     aiScene* export_scene = nullptr;
-    if (result.count("outputfile"))
+    if (output_file.has_value() && ! isRawUvsFile(*output_file))
     {
         aiCopyScene(scene, &export_scene);
     }
+    end_step(&Profile::export_duration);
 
+    bool succeeded = true;
     for (size_t i = 0; i < scene->mNumMeshes; i++)
     {
         const aiMesh* mesh = scene->mMeshes[i];
@@ -85,84 +416,804 @@ int main(int argc, char** argv)
         }
 
         std::vector<Vertex> vertices;
-        vertices.reserve(mesh->mNumVertices);
-        for (size_t j = 0; j < mesh->mNumVertices; j++)
+        std::vector<Face> indices;
+        convertMesh(mesh, vertices, indices);
+        end_step(&Profile::load);
+
+        UnwrapResult unwrap_result;
+        const bool unwrapped = unwrapMesh(vertices, indices, result, cache, unwrap_result, profile);
+        step_start = std::chrono::steady_clock::now();
+        if (! unwrapped)
         {
-            const aiVector3D vertex = mesh->mVertices[j];
-            vertices.emplace_back(vertex.x, vertex.y, vertex.z);
+            succeeded = false;
+            continue;
         }
 
-        std::vector<Face> indices;
-        indices.reserve(mesh->mNumFaces);
-        for (size_t j = 0; j < mesh->mNumFaces; j++)
+        if (output_file.has_value() && isRawUvsFile(*output_file))
         {
-            const aiFace& face = mesh->mFaces[j];
-            indices.emplace_back(face.mIndices[0], face.mIndices[1], face.mIndices[2]);
+            succeeded = writeRawUvs(*output_file, i, scene->mNumMeshes, unwrap_result) && succeeded;
         }
 
-        std::vector<UVCoord> uv_coords(mesh->mNumVertices, { 0.0, 0.0 });
-        uint32_t texture_width, texture_height;
-
-        spdlog::stopwatch timer;
+        if (result.count("atlas-images"))
+        {
+            succeeded = writeAtlasImages(result["atlas-images"].as<std::string>(), i, scene->mNumMeshes, unwrap_result) && succeeded;
+        }
 
-        spdlog::info("Start UV unwrapping");
-        if (smartUnwrap(vertices, indices, uv_coords, texture_width, texture_height))
+        if (export_scene)
         {
-            spdlog::info("Suggested texture size is {}x{}", texture_width, texture_height);
-            spdlog::info("UV unwrapping took {}ms", timer.elapsed_ms().count());
+            aiMesh* export_mesh = export_scene->mMeshes[i];
+
+            // Vertices on charts seams have been split, so rebuild the vertices attributes and faces accordingly
+            if (unwrap_result.uv_coords.size() != export_mesh->mNumVertices)
+            {
+                const auto remap_vertex_attribute = [&unwrap_result](auto*& attribute)
+                {
+                    if (! attribute)
+                    {
+                        return;
+                    }
+
+                    using AttributeType = std::remove_reference_t<decltype(*attribute)>;
+                    auto* remapped_attribute = new AttributeType[unwrap_result.vertex_xref.size()];
+                    for (size_t k = 0; k < unwrap_result.vertex_xref.size(); k++)
+                    {
+                        remapped_attribute[k] = attribute[unwrap_result.vertex_xref[k]];
+                    }
+                    delete[] attribute;
+                    attribute = remapped_attribute;
+                };
+
+                remap_vertex_attribute(export_mesh->mVertices);
+                remap_vertex_attribute(export_mesh->mNormals);
+                remap_vertex_attribute(export_mesh->mTangents);
+                remap_vertex_attribute(export_mesh->mBitangents);
+                for (size_t j = 0; j < AI_MAX_NUMBER_OF_COLOR_SETS; j++)
+                {
+                    remap_vertex_attribute(export_mesh->mColors[j]);
+                }
+                export_mesh->mNumVertices = static_cast<unsigned int>(unwrap_result.uv_coords.size());
+
+                for (size_t j = 0; j < export_mesh->mNumFaces; j++)
+                {
+                    aiFace& export_face = export_mesh->mFaces[j];
+                    const Face& face = unwrap_result.faces[j];
+                    export_face.mIndices[0] = face.i1;
+                    export_face.mIndices[1] = face.i2;
+                    export_face.mIndices[2] = face.i3;
+                }
+            }
+
+            if (! export_mesh->mTextureCoordsNames)
+            {
+                export_mesh->mTextureCoordsNames = new aiString* [AI_MAX_NUMBER_OF_TEXTURECOORDS] {};
+            }
 
-            if (export_scene)
+            for (size_t j = 0; j < AI_MAX_NUMBER_OF_TEXTURECOORDS; j++)
             {
-                aiMesh* export_mesh = export_scene->mMeshes[i];
+                delete export_mesh->mTextureCoordsNames[j];
+                delete export_mesh->mTextureCoords[j];
+
+                if (j == 0)
+                {
+                    export_mesh->mNumUVComponents[j] = 2;
+                    export_mesh->mTextureCoordsNames[j] = new aiString("unwrapped");
+                    export_mesh->mTextureCoords[j] = new aiVector3D[export_mesh->mNumVertices];
+                    for (size_t k = 0; k < export_mesh->mNumVertices; k++)
+                    {
+                        const UVCoord& uv = unwrap_result.uv_coords[k];
+                        aiVector3D& export_uv = export_mesh->mTextureCoords[j][k];
+                        export_uv.x = uv.u;
+                        export_uv.y = uv.v;
+                    }
+                }
+                else
+                {
+                    export_mesh->mNumUVComponents[j] = 0;
+                    export_mesh->mTextureCoordsNames[j] = nullptr;
+                    export_mesh->mTextureCoords[j] = nullptr;
+                }
+            }
+        }
+        end_step(&Profile::export_duration);
+    }
+
+    if (export_scene)
+    {
+        spdlog::info("Exporting result to {}", output_file->string());
+
+        Assimp::Exporter exporter;
+        exporter.Export(export_scene, "obj", output_file->string());
+
+        aiFreeScene(export_scene);
+    }
+    end_step(&Profile::export_duration);
+
+    return succeeded;
+}
+
+/*!
+ * Report of the unwrapping of a file of a batch
+ */
+struct FileReport
+{
+    std::filesystem::path file;
+    bool succeeded{ false };
+    std::string error; // Reason of the failure, if any
+    size_t meshes_count{ 0 };
+    size_t vertices_count{ 0 };
+    size_t faces_count{ 0 };
+    double load_ms{ 0.0 };
+    double unwrap_ms{ 0.0 }; // Total time spent in the stages of the unwrapping of the meshes
+    uint32_t charts_count{ 0 };
+    float utilization{ 0.0F }; // Average utilization of the atlases of the meshes
+    size_t peak_memory{ 0 }; // Largest peak amount of temporary memory used by the unwrapping of a mesh, in bytes
+    size_t peak_rss{ 0 }; // Peak resident set size of the process when the file was completed, in bytes
+};
+
+/*!
+ * Meshes of a file of a batch, kept until all of them have been unwrapped
+ */
+struct BatchFile
+{
+    FileReport* report{ nullptr };
+    std::optional<mesh_io::LoadedMesh> loaded_mesh;
+    std::vector<std::vector<Vertex>> vertices; // Meshes loaded by Assimp
+    std::vector<std::vector<Face>> faces;
+    std::vector<MeshView> meshes;
+    std::optional<std::filesystem::path> output_file; // Raw UV file of the meshes
+    size_t pending_meshes{ 0 };
+    size_t estimated_memory{ 0 };
+    bool written{ true }; // Whether all the output files could be written
+};
+
+/*! @return The peak resident set size of the process, in bytes, or 0 if it can not be measured */
+static size_t peakResidentSetSize()
+{
+#if defined(__APPLE__)
+    struct rusage usage = {};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<size_t>(usage.ru_maxrss) : 0;
+#elif defined(__unix__)
+    struct rusage usage = {};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<size_t>(usage.ru_maxrss) * 1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+/*!
+ * Lists the files of a batch
+ * @param batch_path A directory, whose mesh files are listed recursively, or a text file listing a file per line. Empty lines and lines starting with
+ *                   '#' are ignored, and relative paths are relative to the directory of the list.
+ * @return The files of the batch, sorted for directories, in the order of the list otherwise, or nothing if the path can't be read or lists no file
+ */
+static std::optional<std::vector<std::filesystem::path>> listBatchFiles(const std::filesystem::path& batch_path)
+{
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    if (std::filesystem::is_directory(batch_path, error))
+    {
+        // Unreadable subdirectories are skipped, so that they don't abort the batch
+        const Assimp::Importer importer;
+        std::filesystem::recursive_directory_iterator iterator(batch_path, std::filesystem::directory_options::skip_permission_denied, error);
+        for (; ! error && iterator != std::filesystem::recursive_directory_iterator(); iterator.increment(error))
+        {
+            const std::string extension = iterator->path().extension().string();
+            std::error_code file_error;
+            if (iterator->is_regular_file(file_error) && (extension == ".uvm" || (! extension.empty() && importer.IsExtensionSupported(extension))))
+            {
+                files.push_back(iterator->path());
+            }
+        }
+        if (error)
+        {
+            spdlog::warn("Unable to list all the files of {}: {}", batch_path.string(), error.message());
+        }
+        if (files.empty())
+        {
+            spdlog::error("No mesh file found in {}", batch_path.string());
+            return std::nullopt;
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::ifstream list(batch_path);
+    if (! list)
+    {
+        spdlog::error("Unable to read the batch directory or list {}", batch_path.string());
+        return std::nullopt;
+    }
+    std::string line;
+    while (std::getline(list, line))
+    {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (! line.empty() && line.front() != '#')
+        {
+            const std::filesystem::path file = line;
+            files.push_back(file.is_absolute() ? file : batch_path.parent_path() / file);
+        }
+    }
+    if (files.empty())
+    {
+        spdlog::error("The batch list {} contains no file", batch_path.string());
+        return std::nullopt;
+    }
+    return files;
+}
+
+/*!
+ * Loads the meshes of a file of a batch
+ * @param batch_file The file, whose meshes are set
+ * @return An empty string if the file was loaded, or the reason of the failure
+ */
+static std::string loadBatchFile(BatchFile& batch_file)
+{
+    const std::filesystem::path& path = batch_file.report->file;
+    batch_file.loaded_mesh = mesh_io::loadMesh(path);
+    if (batch_file.loaded_mesh.has_value())
+    {
+        batch_file.meshes.push_back(MeshView{ .vertices = batch_file.loaded_mesh->vertices, .faces = batch_file.loaded_mesh->faces });
+        return {};
+    }
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path.string(), 0);
+    if (! scene)
+    {
+        return importer.GetErrorString();
+    }
+    if (! scene->HasMeshes())
+    {
+        return "The file doesn't contain any mesh";
+    }
+
+    batch_file.vertices.resize(scene->mNumMeshes);
+    batch_file.faces.resize(scene->mNumMeshes);
+    for (size_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        convertMesh(scene->mMeshes[i], batch_file.vertices[i], batch_file.faces[i]);
+        batch_file.meshes.push_back(MeshView{ .vertices = batch_file.vertices[i], .faces = batch_file.faces[i] });
+    }
+    return {};
+}
+
+/*! @return The text quoted and escaped for a JSON document */
+static std::string jsonString(std::string_view text)
+{
+    std::string quoted = "\"";
+    for (const char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            quoted += '\\';
+            quoted += character;
+        }
+        else if (static_cast<unsigned char>(character) < 0x20)
+        {
+            quoted += fmt::format("\\u{:04x}", character);
+        }
+        else
+        {
+            quoted += character;
+        }
+    }
+    return quoted + '"';
+}
+
+/*! @return The text quoted and escaped for a CSV file */
+static std::string csvString(std::string_view text)
+{
+    std::string quoted = "\"";
+    for (const char character : text)
+    {
+        quoted += character;
+        if (character == '"')
+        {
+            quoted += '"';
+        }
+    }
+    return quoted + '"';
+}
 
-                if (! export_mesh->mTextureCoordsNames)
+/*!
+ * Writes the report of a batch, as JSON if the path has a .json extension, or else as CSV
+ * @param path The path of the report
+ * @param reports The reports of the files of the batch
+ * @return True if the report could be written
+ */
+static bool writeBatchReport(const std::filesystem::path& path, const std::vector<FileReport>& reports)
+{
+    std::ofstream file(path, std::ios::trunc);
+    const bool json = path.extension() == ".json";
+    if (json)
+    {
+        file << "[\n";
+    }
+    else
+    {
+        file << "file,succeeded,error,meshes,vertices,faces,load_ms,unwrap_ms,charts,utilization,peak_memory_mb,peak_rss_mb\n";
+    }
+
+    for (size_t index = 0; index < reports.size(); ++index)
+    {
+        const FileReport& report = reports[index];
+        if (json)
+        {
+            file << fmt::format(
+                "  {{\"file\": {}, \"succeeded\": {}, \"error\": {}, \"meshes\": {}, \"vertices\": {}, \"faces\": {}, \"load_ms\": {:.3f}, \"unwrap_ms\": {:.3f}, "
+                "\"charts\": {}, \"utilization\": {:.4f}, \"peak_memory_mb\": {:.3f}, \"peak_rss_mb\": {:.3f}}}{}\n",
+                jsonString(report.file.string()),
+                report.succeeded,
+                jsonString(report.error),
+                report.meshes_count,
+                report.vertices_count,
+                report.faces_count,
+                report.load_ms,
+                report.unwrap_ms,
+                report.charts_count,
+                report.utilization,
+                report.peak_memory / 1.0e6,
+                report.peak_rss / 1.0e6,
+                index + 1 < reports.size() ? "," : "");
+        }
+        else
+        {
+            file << fmt::format(
+                "{},{},{},{},{},{},{:.3f},{:.3f},{},{:.4f},{:.3f},{:.3f}\n",
+                csvString(report.file.string()),
+                report.succeeded,
+                csvString(report.error),
+                report.meshes_count,
+                report.vertices_count,
+                report.faces_count,
+                report.load_ms,
+                report.unwrap_ms,
+                report.charts_count,
+                report.utilization,
+                report.peak_memory / 1.0e6,
+                report.peak_rss / 1.0e6);
+        }
+    }
+
+    if (json)
+    {
+        file << "]\n";
+    }
+    return static_cast<bool>(file);
+}
+
+/*!
+ * Makes the path of the output file of a file of a batch, relative to the output directory
+ * @param file The path of the file of the batch
+ * @param base_directory The directory the paths of the batch are relative to, i.e. the batch directory or the directory of the list
+ * @return The path of the file relative to the base directory, or its whole absolute path when it is outside of it, so that distinct files never share
+ *         the same output
+ */
+static std::filesystem::path batchOutputPath(const std::filesystem::path& file, const std::filesystem::path& base_directory)
+{
+    std::error_code error;
+    const std::filesystem::path absolute_file = std::filesystem::absolute(file, error).lexically_normal();
+    const std::filesystem::path absolute_base = std::filesystem::absolute(base_directory, error).lexically_normal();
+    const std::filesystem::path relative_file = absolute_file.lexically_relative(absolute_base);
+    if (relative_file.empty() || *relative_file.begin() == "..")
+    {
+        return absolute_file.relative_path();
+    }
+    return relative_file;
+}
+
+/*!
+ * Unwraps the files of a batch concurrently, on a pool of threads. A file is loaded once there is a free thread to unwrap it, and submitted once its
+ * estimated memory fits in the budget, along with the files being unwrapped. Files that fail to load or unwrap are reported, without stopping the batch.
+ * @param batch_path The directory or list of the files, @sa listBatchFiles()
+ * @param result The parsed command line
+ * @return True if the files could be listed and were all unwrapped
+ */
+static bool processBatch(const std::filesystem::path& batch_path, const cxxopts::ParseResult& result)
+{
+    const std::optional<std::vector<std::filesystem::path>> listed_files = listBatchFiles(batch_path);
+    if (! listed_files.has_value())
+    {
+        return false;
+    }
+
+    const std::vector<std::filesystem::path>& files = *listed_files;
+    std::vector<FileReport> reports(files.size());
+    std::optional<std::filesystem::path> output_directory;
+    if (result.count("outputfile"))
+    {
+        output_directory = result["outputfile"].as<std::string>();
+        std::error_code error;
+        std::filesystem::create_directories(*output_directory, error);
+        if (error)
+        {
+            spdlog::error("Unable to create the output directory {}: {}", output_directory->string(), error.message());
+            return false;
+        }
+    }
+    std::error_code batch_path_error;
+    const std::filesystem::path base_directory = std::filesystem::is_directory(batch_path, batch_path_error) ? batch_path : batch_path.parent_path();
+    std::set<std::filesystem::path> output_files;
+
+    // Protects the reports and counters below, which are updated by the completions of the unwrappings, on the threads of the pool
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t running_files = 0;
+    size_t running_memory = 0;
+    size_t completed_files = 0;
+
+    UnwrapOptions unwrap_options;
+    unwrap_options.track_memory = true;
+    UnwrapPool pool(result.count("threads") ? result["threads"].as<uint32_t>() : 0);
+    const size_t memory_budget = result["batch-memory"].as<uint64_t>() * 1'000'000;
+    spdlog::info("Unwrapping {} files with {} threads and a memory budget of {}MB", files.size(), pool.threadCount(), memory_budget / 1'000'000);
+
+    const auto complete_file = [&](BatchFile& batch_file) // Called with the mutex locked
+    {
+        FileReport& report = *batch_file.report;
+        report.peak_rss = peakResidentSetSize();
+        report.succeeded = report.error.empty() && batch_file.written;
+        if (report.error.empty() && ! batch_file.written)
+        {
+            report.error = "Unable to write the output file";
+        }
+        ++completed_files;
+        if (report.succeeded)
+        {
+            spdlog::info(
+                "[{}/{}] {}: {} charts, {:.1f}% utilization, {:.1f}ms",
+                completed_files,
+                files.size(),
+                report.file.string(),
+                report.charts_count,
+                report.utilization * 100.0F,
+                report.unwrap_ms);
+        }
+        else
+        {
+            spdlog::error("[{}/{}] {}: {}", completed_files, files.size(), report.file.string(), report.error);
+        }
+    };
+
+    for (size_t index = 0; index < files.size(); ++index)
+    {
+        auto batch_file = std::make_shared<BatchFile>();
+        FileReport& report = reports[index];
+        report.file = files[index];
+        batch_file->report = &report;
+
+        // Output files keep the path of their input file relative to the batch directory, or to the list, and its extension, so that files of different
+        // formats don't collide. A file listed twice would still overwrite its own output, so its second occurrence fails.
+        if (output_directory.has_value())
+        {
+            batch_file->output_file = *output_directory / batchOutputPath(report.file, base_directory);
+            *batch_file->output_file += ".uvu";
+            if (! output_files.insert(batch_file->output_file->lexically_normal()).second)
+            {
+                report.error = fmt::format("The output file {} is already written by another file of the batch", batch_file->output_file->string());
+            }
+            else
+            {
+                std::error_code error;
+                std::filesystem::create_directories(batch_file->output_file->parent_path(), error);
+                if (error)
                 {
-                    export_mesh->mTextureCoordsNames = new aiString* [AI_MAX_NUMBER_OF_TEXTURECOORDS] {};
+                    report.error = fmt::format("Unable to create the directory {}: {}", batch_file->output_file->parent_path().string(), error.message());
                 }
+            }
+            if (! report.error.empty())
+            {
+                std::lock_guard lock(mutex);
+                complete_file(*batch_file);
+                continue;
+            }
+        }
+
+        // Wait for a free thread before loading the file, so that loaded files don't pile up
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(
+                lock,
+                [&]()
+                {
+                    return running_files < pool.threadCount();
+                });
+        }
+
+        spdlog::stopwatch load_timer;
+        try
+        {
+            report.error = loadBatchFile(*batch_file);
+        }
+        catch (const std::exception& exception)
+        {
+            report.error = exception.what();
+        }
+        report.load_ms = std::chrono::duration<double, std::milli>(load_timer.elapsed()).count();
+        if (! report.error.empty())
+        {
+            std::lock_guard lock(mutex);
+            complete_file(*batch_file);
+            continue;
+        }
+
+        report.meshes_count = batch_file->meshes.size();
+        for (const MeshView& mesh : batch_file->meshes)
+        {
+            report.vertices_count += mesh.vertices.size();
+            report.faces_count += mesh.faces.size();
+            batch_file->estimated_memory += estimateUnwrapMemory(mesh.vertices.size(), mesh.faces.size());
+        }
+        batch_file->pending_meshes = batch_file->meshes.size();
+
+        // A file larger than the budget is unwrapped alone
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(
+                lock,
+                [&]()
+                {
+                    return running_files == 0 || running_memory + batch_file->estimated_memory <= memory_budget;
+                });
+            ++running_files;
+            running_memory += batch_file->estimated_memory;
+        }
 
-                for (size_t j = 0; j < AI_MAX_NUMBER_OF_TEXTURECOORDS; j++)
+        for (size_t mesh_index = 0; mesh_index < batch_file->meshes.size(); ++mesh_index)
+        {
+            pool.submit(
+                batch_file->meshes[mesh_index],
+                unwrap_options,
+                [&, batch_file, mesh_index](std::optional<UnwrapResult> unwrap_result)
                 {
-                    delete export_mesh->mTextureCoordsNames[j];
-                    delete export_mesh->mTextureCoords[j];
+                    FileReport& file_report = *batch_file->report;
+                    bool written = true;
+                    if (unwrap_result.has_value() && batch_file->output_file.has_value())
+                    {
+                        written = writeRawUvs(*batch_file->output_file, mesh_index, batch_file->meshes.size(), *unwrap_result);
+                    }
 
-                    if (j == 0)
+                    std::lock_guard lock(mutex);
+                    batch_file->written = batch_file->written && written;
+                    if (unwrap_result.has_value())
                     {
-                        export_mesh->mNumUVComponents[j] = 2;
-                        export_mesh->mTextureCoordsNames[j] = new aiString("unwrapped");
-                        export_mesh->mTextureCoords[j] = new aiVector3D[export_mesh->mNumVertices];
-                        for (size_t k = 0; k < export_mesh->mNumVertices; k++)
+                        for (const std::chrono::steady_clock::duration duration : unwrap_result->stats.stage_durations)
                         {
-                            const UVCoord& uv = uv_coords[k];
-                            aiVector3D& export_uv = export_mesh->mTextureCoords[j][k];
-                            export_uv.x = uv.u;
-                            export_uv.y = uv.v;
+                            file_report.unwrap_ms += std::chrono::duration<double, std::milli>(duration).count();
                         }
+                        file_report.charts_count += unwrap_result->stats.charts_count;
+                        file_report.utilization += unwrap_result->stats.utilization / static_cast<float>(batch_file->meshes.size());
+                        file_report.peak_memory = std::max(file_report.peak_memory, unwrap_result->stats.peak_memory);
                     }
                     else
                     {
-                        export_mesh->mNumUVComponents[j] = 0;
-                        export_mesh->mTextureCoordsNames[j] = nullptr;
-                        export_mesh->mTextureCoords[j] = nullptr;
+                        file_report.error = "Couldn't unwrap UVs";
                     }
-                }
-            }
+
+                    if (--batch_file->pending_meshes == 0)
+                    {
+                        complete_file(*batch_file);
+                        --running_files;
+                        running_memory -= batch_file->estimated_memory;
+                        condition.notify_all();
+                    }
+                });
         }
-        else
+    }
+
+    {
+        std::unique_lock lock(mutex);
+        condition.wait(
+            lock,
+            [&]()
+            {
+                return running_files == 0;
+            });
+    }
+
+    const size_t failed_files = std::count_if(
+        reports.begin(),
+        reports.end(),
+        [](const FileReport& report)
         {
-            spdlog::error("Couldn't unwrap UVs!");
+            return ! report.succeeded;
+        });
+    spdlog::info("Unwrapped {} files, {} failed", files.size() - failed_files, failed_files);
+
+    if (result.count("report"))
+    {
+        const std::filesystem::path report_file = result["report"].as<std::string>();
+        spdlog::info("Writing the report to {}", report_file.string());
+        if (! writeBatchReport(report_file, reports))
+        {
+            spdlog::error("Unable to write {}", report_file.string());
+            return false;
         }
     }
 
-    if (export_scene)
+    return failed_files == 0;
+}
+
+/*! @return The name of a step of a profile in JSON reports, in snake case */
+static std::string profileStepKey(std::string_view name)
+{
+    std::string key;
+    for (const char character : name)
     {
-        const std::string output_file = result["outputfile"].as<std::string>();
-        spdlog::info("Exporting result to {}", output_file);
+        key += character == ' ' ? '_' : static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+    }
+    return key;
+}
 
-        Assimp::Exporter exporter;
-        exporter.Export(export_scene, "obj", output_file);
+/*!
+ * Displays the profile of a file, and writes it as a JSON report if requested
+ * @param profile The profile of the file
+ * @param file_path The path of the file
+ * @param report_file The path of the JSON report, if any
+ * @return True if the report could be written
+ */
+static bool reportProfile(const Profile& profile, const std::string& file_path, const std::optional<std::filesystem::path>& report_file)
+{
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    std::vector<std::pair<std::string_view, std::chrono::steady_clock::duration>> steps{ { "load", profile.load } };
+    std::chrono::steady_clock::duration stages_duration{};
+    for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+    {
+        steps.emplace_back(unwrapStageName(static_cast<UnwrapStage>(stage)), profile.stages[stage]);
+        stages_duration += profile.stages[stage];
+    }
+    steps.emplace_back("unwrap overhead", profile.unwrap - stages_duration); // Creation of the scheduler and copy of the result
+    steps.emplace_back("export", profile.export_duration);
+    const std::chrono::steady_clock::duration total = profile.load + profile.unwrap + profile.export_duration;
 
-        aiFreeScene(export_scene);
+    // Charts are counted over the packing stages, which are the ones whose time depends on them
+    const std::chrono::duration<double> unwrap_seconds = profile.unwrap;
+    const std::chrono::duration<double> packing_seconds = profile.stages[static_cast<size_t>(UnwrapStage::ChartsPreprocessing)]
+                                                        + profile.stages[static_cast<size_t>(UnwrapStage::Rasterization)]
+                                                        + profile.stages[static_cast<size_t>(UnwrapStage::Placement)];
+    const double faces_per_second = unwrap_seconds.count() > 0.0 ? static_cast<double>(profile.faces_count) / unwrap_seconds.count() : 0.0;
+    const double charts_per_second = packing_seconds.count() > 0.0 ? static_cast<double>(profile.charts_count) / packing_seconds.count() : 0.0;
+
+    spdlog::info("Profile of {} faces and {} charts:", profile.faces_count, profile.charts_count);
+    for (const auto& [name, duration] : steps)
+    {
+        spdlog::info("    {:<22}{:>10.1f}ms {:>5.1f}%", name, Milliseconds(duration).count(), total.count() > 0 ? 100.0 * duration / total : 0.0);
     }
+    spdlog::info("    {:<22}{:>10.1f}ms", "total", Milliseconds(total).count());
+    spdlog::info("    {:.0f} faces/s unwrapped, {:.0f} charts/s packed", faces_per_second, charts_per_second);
 
-    return 0;
-}
\ No newline at end of file
+    if (! report_file.has_value())
+    {
+        return true;
+    }
+
+    std::string steps_json;
+    for (const auto& [name, duration] : steps)
+    {
+        steps_json += fmt::format("{}\"{}\": {:.3f}", steps_json.empty() ? "" : ", ", profileStepKey(name), Milliseconds(duration).count());
+    }
+    std::ofstream file(*report_file, std::ios::trunc);
+    file << fmt::format(
+        "{{\"file\": {}, \"vertices\": {}, \"faces\": {}, \"charts\": {}, \"total_ms\": {:.3f}, \"steps_ms\": {{{}}}, \"faces_per_second\": {:.1f}, "
+        "\"charts_per_second\": {:.1f}}}\n",
+        jsonString(file_path),
+        profile.vertices_count,
+        profile.faces_count,
+        profile.charts_count,
+        Milliseconds(total).count(),
+        steps_json,
+        faces_per_second,
+        charts_per_second);
+    if (! file)
+    {
+        spdlog::error("Unable to write {}", report_file->string());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("Uvula", "Test interface for the libuvula library");
+    options.add_options()("filepath", "Path of the 3D mesh file to be loaded (OBJ, STL, PLY, raw .uvm, ...)", cxxopts::value<std::string>())(
+        "o,outputfile",
+        "Path of the output 3D mesh with UV coordinates (OBJ), or of the raw UV coordinates of the corners of the faces (.uvu)",
+        cxxopts::value<std::string>())("m,memory", "Track and display the memory usage of the unwrapping")(
+        "t,timings",
+        "Display the time spent in each stage of the unwrapping")(
+        "j,threads",
+        "Number of threads to be used, by default all the CPUs available to the process. In batch mode, it also bounds the number of files unwrapped at once.",
+        cxxopts::value<uint32_t>())("p,pin", "Pin the worker threads to the CPUs available to the process")(
+        "c,cache",
+        "Directory of the cache of unwrapping results, so that meshes that were already unwrapped are loaded from it",
+        cxxopts::value<std::string>())("cache-size", "Maximum size of the cache of unwrapping results, in MB", cxxopts::value<uint64_t>()->default_value("1024"))("d,debug", "Display debug output, including per-thread task counts")(
+        "b,batch",
+        "Unwrap all the mesh files of a directory, or listed in a text file, concurrently. The output file is then the directory of the raw UV files.",
+        cxxopts::value<std::string>())("batch-memory", "Memory budget of the unwrappings running concurrently in batch mode, in MB", cxxopts::value<uint64_t>()->default_value("4096"))(
+        "r,report",
+        "Path of the report of the batch, written as JSON with a .json extension, or else as CSV",
+        cxxopts::value<std::string>())(
+        "atlas-images",
+        "Prefix of the paths of the occupancy mask and chart index images of the packed atlas, written as PGM at the texture size. Ignored in batch mode.",
+        cxxopts::value<std::string>())("profile", "Display the time spent in each step of the processing, from the loading to the export, and the throughput")(
+        "profile-json",
+        "Path of the profile written as JSON, which implies --profile",
+        cxxopts::value<std::string>())("h,help", "Print this help and exit");
+    options.parse_positional({ "filepath" });
+    options.positional_help("<filepath>");
+    options.show_positional_help();
+
+    cxxopts::ParseResult result = options.parse(argc, argv);
+    if (result.count("help") || ! (result.count("filepath") || result.count("batch")))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    if (result.count("debug"))
+    {
+        spdlog::set_level(spdlog::level::debug);
+    }
+
+    if (result.count("batch"))
+    {
+        return processBatch(result["batch"].as<std::string>(), result) ? 0 : 1;
+    }
+
+    std::optional<UnwrapCache> cache;
+    if (result.count("cache"))
+    {
+        cache.emplace(result["cache"].as<std::string>(), result["cache-size"].as<uint64_t>() * 1'000'000);
+    }
+
+    std::optional<std::filesystem::path> output_file;
+    if (result.count("outputfile"))
+    {
+        output_file = result["outputfile"].as<std::string>();
+    }
+
+    const std::string file_path = result["filepath"].as<std::string>();
+    spdlog::info("Loading mesh from {}", file_path);
+
+    std::optional<Profile> profile;
+    std::optional<std::filesystem::path> profile_file;
+    if (result.count("profile-json"))
+    {
+        profile_file = result["profile-json"].as<std::string>();
+    }
+    if (result.count("profile") || profile_file.has_value())
+    {
+        profile.emplace();
+    }
+
+    // Raw meshes, binary STL and PLY files are memory-mapped and parsed directly, the other formats are loaded by Assimp
+    bool succeeded;
+    const std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    if (const std::optional<mesh_io::LoadedMesh> mesh = mesh_io::loadMesh(file_path))
+    {
+        const std::chrono::steady_clock::duration load_duration = std::chrono::steady_clock::now() - load_start;
+        spdlog::debug("Loading took {:.1f}ms", std::chrono::duration<double, std::milli>(load_duration).count());
+        if (profile.has_value())
+        {
+            profile->load = load_duration;
+        }
+        succeeded = processLoadedMesh(*mesh, output_file, result, cache, profile.has_value() ? &*profile : nullptr);
+    }
+    else
+    {
+        // Include the time spent trying the direct loading
+        if (profile.has_value())
+        {
+            profile->load = std::chrono::steady_clock::now() - load_start;
+        }
+        succeeded = processAssimpFile(file_path, output_file, result, cache, profile.has_value() ? &*profile : nullptr);
+    }
+
+    if (profile.has_value())
+    {
+        succeeded = reportProfile(*profile, file_path, profile_file) && succeeded;
+    }
+
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,526 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "mesh_io.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "UVCoord.h"
+#include "UnwrapResult.h"
+#include "raw_files.h"
+
+namespace mesh_io
+{
+
+// Size of the header of a binary STL file, then of the faces count and of each face
+static constexpr size_t stl_header_size = 80;
+static constexpr size_t stl_face_size = 50;
+
+// Size of the text written to an OBJ file at once
+static constexpr size_t obj_buffer_size = size_t(1) << 20;
+
+/*!
+ * Hash table giving a single index to the vertices that have bitwise equal positions. It starts from an estimate of the number of distinct vertices, and
+ * grows as they are added.
+ */
+class VertexWelder
+{
+public:
+    explicit VertexWelder(size_t expected_vertices_count, std::vector<Vertex>& vertices)
+        : vertices_(vertices)
+    {
+        size_t capacity = 16;
+        while (capacity < expected_vertices_count * 2)
+        {
+            capacity *= 2;
+        }
+        slots_.assign(capacity, empty_slot);
+        mask_ = capacity - 1;
+        vertices_.reserve(expected_vertices_count);
+    }
+
+    /*! @return The index of the vertex with the given position, which is added if it is new */
+    uint32_t weld(Vertex vertex)
+    {
+        // Adding 0 turns -0 into +0, so that they are welded
+        vertex = Vertex{ vertex.x + 0.0F, vertex.y + 0.0F, vertex.z + 0.0F };
+        const auto x = std::bit_cast<uint32_t>(vertex.x);
+        const auto y = std::bit_cast<uint32_t>(vertex.y);
+        const auto z = std::bit_cast<uint32_t>(vertex.z);
+        for (size_t slot = hash(vertex) & mask_;; slot = (slot + 1) & mask_)
+        {
+            const uint32_t index = slots_[slot];
+            if (index == empty_slot)
+            {
+                const auto new_index = static_cast<uint32_t>(vertices_.size());
+                slots_[slot] = new_index;
+                vertices_.push_back(vertex);
+
+                // Keep the table at most half full
+                if (vertices_.size() * 2 > slots_.size())
+                {
+                    rehash(slots_.size() * 2);
+                }
+                return new_index;
+            }
+
+            const Vertex& other = vertices_[index];
+            if (std::bit_cast<uint32_t>(other.x) == x && std::bit_cast<uint32_t>(other.y) == y && std::bit_cast<uint32_t>(other.z) == z)
+            {
+                return index;
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+
+    static uint64_t hash(const Vertex& vertex)
+    {
+        const auto x = std::bit_cast<uint32_t>(vertex.x);
+        const auto y = std::bit_cast<uint32_t>(vertex.y);
+        const auto z = std::bit_cast<uint32_t>(vertex.z);
+        uint64_t hash = (static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ULL) ^ (static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4FULL) ^ (static_cast<uint64_t>(z) * 0x165667B19E3779F9ULL);
+        return hash ^ (hash >> 29);
+    }
+
+    void rehash(size_t capacity)
+    {
+        slots_.assign(capacity, empty_slot);
+        mask_ = capacity - 1;
+        for (size_t index = 0; index < vertices_.size(); ++index)
+        {
+            size_t slot = hash(vertices_[index]) & mask_;
+            while (slots_[slot] != empty_slot)
+            {
+                slot = (slot + 1) & mask_;
+            }
+            slots_[slot] = static_cast<uint32_t>(index);
+        }
+    }
+
+    std::vector<Vertex>& vertices_;
+    std::vector<uint32_t> slots_;
+    size_t mask_{ 0 };
+};
+
+static std::optional<LoadedMesh> loadRawMesh(std::unique_ptr<MappedFile> file)
+{
+    LoadedMesh mesh;
+    if (! raw_files::viewMesh(file->data(), file->size(), mesh.vertices, mesh.faces))
+    {
+        return std::nullopt;
+    }
+    mesh.mapping = std::move(file);
+    return mesh;
+}
+
+static std::optional<LoadedMesh> loadBinaryStl(const MappedFile& file)
+{
+    uint32_t faces_count = 0;
+    std::memcpy(&faces_count, file.data() + stl_header_size, sizeof(faces_count));
+    if (file.size() != stl_header_size + sizeof(faces_count) + static_cast<size_t>(faces_count) * stl_face_size)
+    {
+        // ASCII files, or truncated binary ones
+        return std::nullopt;
+    }
+
+    // Closed meshes have about half as many vertices as faces once welded, with a margin for the boundaries of open ones. The welder grows for the others.
+    LoadedMesh mesh;
+    VertexWelder welder(static_cast<size_t>(faces_count) / 2 + faces_count / 16, mesh.owned_vertices);
+    mesh.owned_faces.reserve(faces_count);
+    const char* face_data = file.data() + stl_header_size + sizeof(faces_count);
+    for (uint32_t index = 0; index < faces_count; ++index, face_data += stl_face_size)
+    {
+        // Each face holds its normal, the positions of its 3 corners and 2 bytes of attributes
+        std::array<Vertex, 3> corners;
+        std::memcpy(corners.data(), face_data + sizeof(Vertex), sizeof(corners));
+        mesh.owned_faces.push_back(Face{ welder.weld(corners[0]), welder.weld(corners[1]), welder.weld(corners[2]) });
+    }
+
+    mesh.vertices = mesh.owned_vertices;
+    mesh.faces = mesh.owned_faces;
+    return mesh;
+}
+
+enum class PlyType
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;
+    std::optional<PlyType> list_count_type; // Type of the number of values, for list properties
+};
+
+struct PlyElement
+{
+    std::string name;
+    uint64_t count;
+    std::vector<PlyProperty> properties;
+};
+
+static std::optional<PlyType> parsePlyType(const std::string& name)
+{
+    static constexpr std::array<std::pair<std::string_view, PlyType>, 16> types{ {
+        { "char", PlyType::Int8 },
+        { "int8", PlyType::Int8 },
+        { "uchar", PlyType::UInt8 },
+        { "uint8", PlyType::UInt8 },
+        { "short", PlyType::Int16 },
+        { "int16", PlyType::Int16 },
+        { "ushort", PlyType::UInt16 },
+        { "uint16", PlyType::UInt16 },
+        { "int", PlyType::Int32 },
+        { "int32", PlyType::Int32 },
+        { "uint", PlyType::UInt32 },
+        { "uint32", PlyType::UInt32 },
+        { "float", PlyType::Float32 },
+        { "float32", PlyType::Float32 },
+        { "double", PlyType::Float64 },
+        { "float64", PlyType::Float64 },
+    } };
+
+    for (const auto& [type_name, type] : types)
+    {
+        if (name == type_name)
+        {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+static size_t plyTypeSize(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+template<typename T>
+static T readPlyValue(const char* data, PlyType type)
+{
+    const auto read = [data]<typename Stored>(Stored)
+    {
+        Stored value;
+        std::memcpy(&value, data, sizeof(value));
+        return static_cast<T>(value);
+    };
+
+    switch (type)
+    {
+    case PlyType::Int8:
+        return read(int8_t{});
+    case PlyType::UInt8:
+        return read(uint8_t{});
+    case PlyType::Int16:
+        return read(int16_t{});
+    case PlyType::UInt16:
+        return read(uint16_t{});
+    case PlyType::Int32:
+        return read(int32_t{});
+    case PlyType::UInt32:
+        return read(uint32_t{});
+    case PlyType::Float32:
+        return read(float{});
+    case PlyType::Float64:
+        return read(double{});
+    }
+    return T{};
+}
+
+/*!
+ * Parses the header of a binary little-endian PLY file
+ * @param file The content of the file
+ * @param elements The elements declared by the header, in the order of their data
+ * @return The size of the header, or 0 if it is not a supported PLY header
+ */
+static size_t parsePlyHeader(const MappedFile& file, std::vector<PlyElement>& elements)
+{
+    const std::string_view content(file.data(), file.size());
+    static constexpr std::string_view header_end = "end_header";
+    const size_t header_end_position = content.find(header_end);
+    if (header_end_position == std::string_view::npos)
+    {
+        return 0;
+    }
+    size_t header_size = content.find('\n', header_end_position);
+    if (header_size == std::string_view::npos)
+    {
+        return 0;
+    }
+
+    std::istringstream header(std::string(content.substr(0, header_end_position)));
+    std::string line;
+    bool little_endian = false;
+    while (std::getline(header, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format")
+        {
+            std::string format;
+            words >> format;
+            little_endian = format == "binary_little_endian";
+        }
+        else if (keyword == "element")
+        {
+            PlyElement& element = elements.emplace_back();
+            words >> element.name >> element.count;
+        }
+        else if (keyword == "property")
+        {
+            if (elements.empty())
+            {
+                return 0;
+            }
+
+            std::string type_name;
+            words >> type_name;
+            PlyProperty property;
+            if (type_name == "list")
+            {
+                std::string count_type_name;
+                words >> count_type_name >> type_name;
+                property.list_count_type = parsePlyType(count_type_name);
+                if (! property.list_count_type.has_value())
+                {
+                    return 0;
+                }
+            }
+            const std::optional<PlyType> type = parsePlyType(type_name);
+            if (! type.has_value())
+            {
+                return 0;
+            }
+            property.type = *type;
+            words >> property.name;
+            elements.back().properties.push_back(std::move(property));
+        }
+    }
+
+    return little_endian && std::endian::native == std::endian::little ? header_size + 1 : 0;
+}
+
+static std::optional<LoadedMesh> loadBinaryPly(const MappedFile& file)
+{
+    std::vector<PlyElement> elements;
+    const size_t header_size = parsePlyHeader(file, elements);
+    if (header_size == 0)
+    {
+        // ASCII and big-endian files
+        return std::nullopt;
+    }
+
+    LoadedMesh mesh;
+    const char* data = file.data() + header_size;
+    const char* end = file.data() + file.size();
+    for (const PlyElement& element : elements)
+    {
+        // Offsets of the positions of the vertices, and index of the list of indices of the faces
+        std::array<std::optional<std::pair<size_t, PlyType>>, 3> position_properties;
+        std::optional<size_t> indices_property;
+        for (size_t index = 0; index < element.properties.size(); ++index)
+        {
+            const PlyProperty& property = element.properties[index];
+            if (element.name == "vertex" && ! property.list_count_type.has_value() && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+            {
+                position_properties[property.name[0] - 'x'] = std::make_pair(index, property.type);
+            }
+            else if (element.name == "face" && property.list_count_type.has_value() && (property.name == "vertex_indices" || property.name == "vertex_index"))
+            {
+                indices_property = index;
+            }
+        }
+        const bool vertices = element.name == "vertex" && position_properties[0] && position_properties[1] && position_properties[2];
+        if (vertices)
+        {
+            mesh.owned_vertices.reserve(element.count);
+        }
+        std::vector<uint32_t> polygon;
+
+        for (uint64_t item = 0; item < element.count; ++item)
+        {
+            std::array<float, 3> position{};
+            for (size_t index = 0; index < element.properties.size(); ++index)
+            {
+                const PlyProperty& property = element.properties[index];
+                const size_t value_size = plyTypeSize(property.type);
+                size_t values_count = 1;
+                if (property.list_count_type.has_value())
+                {
+                    const size_t count_size = plyTypeSize(*property.list_count_type);
+                    if (static_cast<size_t>(end - data) < count_size)
+                    {
+                        return std::nullopt;
+                    }
+                    values_count = readPlyValue<size_t>(data, *property.list_count_type);
+                    data += count_size;
+                }
+                if (static_cast<size_t>(end - data) / value_size < values_count)
+                {
+                    return std::nullopt;
+                }
+
+                if (vertices && ! property.list_count_type.has_value())
+                {
+                    for (size_t axis = 0; axis < 3; ++axis)
+                    {
+                        if (position_properties[axis]->first == index)
+                        {
+                            position[axis] = readPlyValue<float>(data, property.type);
+                        }
+                    }
+                }
+                else if (indices_property == index)
+                {
+                    polygon.resize(values_count);
+                    for (size_t value = 0; value < values_count; ++value)
+                    {
+                        polygon[value] = readPlyValue<uint32_t>(data + value * value_size, property.type);
+                    }
+                    for (size_t corner = 2; corner < polygon.size(); ++corner)
+                    {
+                        mesh.owned_faces.push_back(Face{ polygon[0], polygon[corner - 1], polygon[corner] });
+                    }
+                }
+                data += values_count * value_size;
+            }
+
+            if (vertices)
+            {
+                mesh.owned_vertices.push_back(Vertex{ position[0], position[1], position[2] });
+            }
+        }
+    }
+
+    if (mesh.owned_vertices.empty() || mesh.owned_faces.empty())
+    {
+        return std::nullopt;
+    }
+    for (const Face& face : mesh.owned_faces)
+    {
+        if (face.i1 >= mesh.owned_vertices.size() || face.i2 >= mesh.owned_vertices.size() || face.i3 >= mesh.owned_vertices.size())
+        {
+            return std::nullopt;
+        }
+    }
+
+    mesh.vertices = mesh.owned_vertices;
+    mesh.faces = mesh.owned_faces;
+    return mesh;
+}
+
+std::optional<LoadedMesh> loadMesh(const std::filesystem::path& path)
+{
+    auto file = std::make_unique<MappedFile>(path);
+    if (file->data() == nullptr)
+    {
+        return std::nullopt;
+    }
+    file->adviseSequential();
+
+    const std::string_view content(file->data(), file->size());
+    uint32_t magic = 0;
+    if (content.size() >= sizeof(magic))
+    {
+        std::memcpy(&magic, content.data(), sizeof(magic));
+    }
+    if (magic == raw_files::mesh_magic)
+    {
+        return loadRawMesh(std::move(file));
+    }
+    if (content.starts_with("ply\n") || content.starts_with("ply\r\n"))
+    {
+        return loadBinaryPly(*file);
+    }
+
+    // Binary STL files have no magic number, and their header may start with "solid" like ASCII files, so they are identified by their size
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char character) { return std::tolower(character); });
+    if (extension == ".stl" && content.size() >= stl_header_size + sizeof(uint32_t))
+    {
+        return loadBinaryStl(*file);
+    }
+
+    return std::nullopt;
+}
+
+bool writeObj(const std::filesystem::path& path, std::span<const Vertex> vertices, const UnwrapResult& result)
+{
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    fmt::memory_buffer buffer;
+    bool written = true;
+    const auto flush = [&](size_t threshold)
+    {
+        if (buffer.size() >= threshold)
+        {
+            written = written && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+            buffer.clear();
+        }
+    };
+
+    for (const uint32_t vertex_index : result.vertex_xref)
+    {
+        const Vertex& vertex = vertices[vertex_index];
+        fmt::format_to(std::back_inserter(buffer), "v {} {} {}\n", vertex.x, vertex.y, vertex.z);
+        flush(obj_buffer_size);
+    }
+    for (const UVCoord& uv_coord : result.uv_coords)
+    {
+        fmt::format_to(std::back_inserter(buffer), "vt {} {}\n", uv_coord.u, uv_coord.v);
+        flush(obj_buffer_size);
+    }
+    for (const Face& face : result.faces)
+    {
+        // OBJ indices start at 1
+        fmt::format_to(std::back_inserter(buffer), "f {0}/{0} {1}/{1} {2}/{2}\n", face.i1 + 1, face.i2 + 1, face.i3 + 1);
+        flush(obj_buffer_size);
+    }
+    flush(0);
+
+    return std::fclose(file) == 0 && written;
+}
+
+}; // namespace mesh_io
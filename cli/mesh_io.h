@@ -0,0 +1,53 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Face.h"
+#include "MappedFile.h"
+#include "Vertex.h"
+
+struct UnwrapResult;
+
+/*
+ * Fast loading and saving of the meshes of the CLI, for the formats that can be read straight from a memory-mapped file, Assimp being used for the others
+ */
+namespace mesh_io
+{
+
+/*!
+ * Mesh loaded by one of the fast paths. The vertices and faces either view the mapped file, for the raw format, or the owned lists, which can be moved
+ * along with the mesh without invalidating the views.
+ */
+struct LoadedMesh
+{
+    std::span<const Vertex> vertices;
+    std::span<const Face> faces;
+    std::unique_ptr<MappedFile> mapping;
+    std::vector<Vertex> owned_vertices;
+    std::vector<Face> owned_faces;
+};
+
+/*!
+ * Loads a raw mesh, binary STL or binary little-endian PLY file. The duplicated vertices of STL files, which store 3 positions per face, are welded.
+ * PLY polygons are triangulated as fans.
+ * @param path The path of the mesh file
+ * @return The loaded mesh, or nothing if the file is not in one of the supported formats, or is invalid, so that it should be loaded with Assimp
+ */
+std::optional<LoadedMesh> loadMesh(const std::filesystem::path& path);
+
+/*!
+ * Writes an unwrapped mesh as an OBJ file, with a texture coordinate per output vertex
+ * @param path The path of the file to be written
+ * @param vertices The positions of the input vertices
+ * @param result The result of the unwrapping, whose output vertices reference the input vertices
+ * @return True if the file could be written
+ */
+bool writeObj(const std::filesystem::path& path, std::span<const Vertex> vertices, const UnwrapResult& result);
+
+}; // namespace mesh_io
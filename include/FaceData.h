@@ -0,0 +1,16 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+
+#include "Vector.h"
+
+struct Face;
+
+struct FaceData
+{
+    const Face* face;
+    size_t face_index;
+    Vector normal;
+};
@@ -0,0 +1,56 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+/*!
+ * View of a whole file in memory. The file is memory-mapped where supported, or else read in memory, and written back on destruction if writable.
+ */
+class MappedFile
+{
+public:
+    /*!
+     * Maps an existing file for reading
+     * @param path The path of the file. If it can not be mapped, the view is empty.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    /*!
+     * Creates or truncates a file of the given size, and maps it for writing
+     * @param path The path of the file. If it can not be created, the view is empty.
+     * @param size The size of the file, in bytes
+     */
+    MappedFile(const std::filesystem::path& path, size_t size);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*! @return The content of the file, or nullptr if it could not be mapped */
+    [[nodiscard]] const char* data() const;
+
+    /*! @return The content of a file mapped for writing, or nullptr if it is read-only or could not be mapped */
+    [[nodiscard]] char* mutableData();
+
+    /*! @return The size of the file, in bytes */
+    [[nodiscard]] size_t size() const;
+
+    /*!
+     * Hints that the file is going to be read sequentially, so that it is read ahead, and its pages released sooner
+     */
+    void adviseSequential() const;
+
+private:
+    char* data_{ nullptr };
+    size_t size_{ 0 };
+    bool writable_{ false };
+#if ! defined(__unix__) && ! defined(__APPLE__)
+    std::filesystem::path path_;
+    std::string buffer_;
+#endif
+};
@@ -0,0 +1,57 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+#include "UnwrapStage.h"
+
+/*!
+ * Thread-safe memory resource that forwards the allocations to an upstream resource, while keeping track of the amount of memory currently in use and
+ * its peak, globally and for each stage of the unwrapping.
+ */
+class MemoryTracker : public std::pmr::memory_resource
+{
+public:
+    explicit MemoryTracker(std::pmr::memory_resource* upstream);
+
+    /*!
+     * Sets the stage that the following allocations belong to
+     * @param stage The new current stage
+     */
+    void enterStage(UnwrapStage stage);
+
+    /*! @return The amount of memory currently in use, in bytes */
+    [[nodiscard]] size_t currentSize() const;
+
+    /*! @return The peak amount of memory in use since the creation of the tracker, in bytes */
+    [[nodiscard]] size_t peakSize() const;
+
+    /*! @return The peak amount of memory in use during the given stage, in bytes */
+    [[nodiscard]] size_t stagePeakSize(UnwrapStage stage) const;
+
+    /*! Function behaving like std::realloc, to be used as an allocation callback with the tracker as user data */
+    static void* reallocate(void* user_data, void* ptr, size_t size);
+
+    /*! Function behaving like std::free, to be used as an allocation callback with the tracker as user data */
+    static void release(void* user_data, void* ptr);
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void addUsage(size_t bytes);
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> current_size_{ 0 };
+    std::atomic<size_t> peak_size_{ 0 };
+    std::atomic<size_t> current_stage_{ 0 };
+    std::array<std::atomic<size_t>, unwrap_stage_count> stage_peak_sizes_{};
+};
@@ -0,0 +1,17 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <span>
+
+#include "Face.h"
+#include "Vertex.h"
+
+/*!
+ * Input mesh of an unwrapping, viewing buffers owned by the caller
+ */
+struct MeshView
+{
+    std::span<const Vertex> vertices; // Position of the vertices
+    std::span<const Face> faces; // Faces composing the mesh, indexing the vertices
+};
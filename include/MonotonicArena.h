@@ -0,0 +1,75 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+#include "allocation.h"
+
+/*!
+ * Thread-safe memory resource that hands out memory from a reserved block by bumping an offset, and only releases it all at once when destroyed.
+ * If the reserved block is exhausted, more blocks of the same size are reserved from the upstream resource.
+ */
+class MonotonicArena : public std::pmr::memory_resource
+{
+public:
+    /*!
+     * Creates the arena and reserves its first block
+     * @param block_size The size of the reserved blocks
+     * @param upstream The resource the blocks are allocated from
+     */
+    explicit MonotonicArena(size_t block_size, std::pmr::memory_resource* upstream = allocation::defaultResource());
+
+    ~MonotonicArena() override;
+
+    MonotonicArena(const MonotonicArena&) = delete;
+
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    /*! @return The amount of memory handed out so far, including alignment padding */
+    [[nodiscard]] size_t usedSize() const;
+
+    /*! @return The total size of the blocks reserved from the upstream resource */
+    [[nodiscard]] size_t reservedSize() const;
+
+    /*!
+     * Function behaving like std::realloc, to be used as an allocation callback with the arena as user data. Shrinking is done in place, and growing
+     * copies the data to a new allocation, as the previous one can not be reused.
+     */
+    static void* reallocate(void* user_data, void* ptr, size_t size);
+
+    /*! Function behaving like std::free, to be used as an allocation callback. Does nothing, the memory is only released with the arena. */
+    static void release(void* user_data, void* ptr);
+
+private:
+    struct Block
+    {
+        Block* next;
+        size_t size;
+        std::atomic<size_t> used;
+
+        [[nodiscard]] unsigned char* data()
+        {
+            return reinterpret_cast<unsigned char*>(this + 1);
+        }
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    Block* reserveBlock(size_t size, Block* next);
+
+private:
+    std::pmr::memory_resource* upstream_;
+    const size_t block_size_;
+    std::atomic<Block*> current_block_;
+    std::atomic<size_t> used_size_{ 0 };
+    std::atomic<size_t> reserved_size_{ 0 };
+    std::mutex reserve_mutex_;
+};
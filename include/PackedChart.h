@@ -0,0 +1,19 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstdint>
+
+/*!
+ * Chart (island of adjacent faces) of an unwrapping result, as placed on the texture
+ */
+struct PackedChart
+{
+    uint32_t first_face{ 0 }; // Index of the first face of the chart in UnwrapResult::chart_faces
+    uint32_t faces_count{ 0 }; // Number of faces of the chart
+    uint32_t x{ 0 }; // Left of the bounding rectangle of the chart, in texels of the texture
+    uint32_t y{ 0 }; // Top of the bounding rectangle of the chart, in texels of the texture
+    uint32_t width{ 0 }; // Width of the bounding rectangle of the chart, in texels of the texture
+    uint32_t height{ 0 }; // Height of the bounding rectangle of the chart, in texels of the texture
+    bool rotated{ false }; // Whether the chart was rotated by 90 degrees to be packed
+};
@@ -0,0 +1,34 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <optional>
+
+#include "xatlas.h"
+
+/*!
+ * Makes the allocations of xatlas on the current thread, and the tasks it runs, use the given callbacks for the lifetime of this object. Without callbacks,
+ * the installed allocation functions are used, even if the thread was running another unwrapping with its own callbacks.
+ */
+class ScopedXatlasAlloc
+{
+public:
+    explicit ScopedXatlasAlloc(const std::optional<xatlas::AllocCallbacks>& callbacks)
+        : callbacks_(callbacks)
+        , previous_callbacks_(xatlas::SetThreadAlloc(callbacks_.has_value() ? &*callbacks_ : nullptr))
+    {
+    }
+
+    ~ScopedXatlasAlloc()
+    {
+        xatlas::SetThreadAlloc(previous_callbacks_);
+    }
+
+    ScopedXatlasAlloc(const ScopedXatlasAlloc&) = delete;
+
+    ScopedXatlasAlloc& operator=(const ScopedXatlasAlloc&) = delete;
+
+private:
+    std::optional<xatlas::AllocCallbacks> callbacks_;
+    const xatlas::AllocCallbacks* previous_callbacks_;
+};
@@ -0,0 +1,24 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstdint>
+
+/*!
+ * Interface to an external thread pool, on which a TaskScheduler can run its work instead of starting its own threads
+ */
+class TaskExecutor
+{
+public:
+    virtual ~TaskExecutor() = default;
+
+    /*! @return The number of jobs that the executor can run concurrently */
+    [[nodiscard]] virtual uint32_t concurrency() const = 0;
+
+    /*!
+     * Runs a job asynchronously on one of the executor threads. The job runs until there are no more tasks to be stolen, then returns.
+     * @param function The function to be called
+     * @param user_data The argument to be given to the function
+     */
+    virtual void execute(void (*function)(void* user_data), void* user_data) = 0;
+};
@@ -0,0 +1,184 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "WorkerStats.h"
+
+class TaskExecutor;
+
+/*!
+ * Work-stealing task scheduler. Each thread owns a deque of tasks, to which it pushes and from which it pops its own tasks, while idle threads steal tasks
+ * from the other end of the deques of the other threads. Idle workers sleep until a task is scheduled, and a single one of them is woken up per task.
+ *
+ * The scheduler is driven by the thread that created it, which has the thread index 0 and helps running the tasks while waiting for them. The worker
+ * threads have the indices 1 to threadCount() - 1. Tasks can schedule and wait for nested tasks.
+ *
+ * The workers are either threads owned by the scheduler, or jobs submitted to an external executor when tasks are scheduled, in which case the scheduler
+ * never starts any thread. The scheduler can be used from a thread of its executor: jobs still queued when it is destroyed return as soon as they start,
+ * so it only waits for the running ones.
+ */
+class TaskScheduler
+{
+public:
+    struct TaskGroup;
+
+    struct Task
+    {
+        void (*function)(void* user_data){ nullptr };
+        void* user_data{ nullptr };
+        TaskGroup* group{ nullptr }; // Set when the task is scheduled
+    };
+
+    /*! Set of tasks that are waited for together */
+    struct TaskGroup
+    {
+        std::atomic<uint32_t> pending_tasks{ 0 };
+    };
+
+    /*!
+     * Creates the scheduler and starts its worker threads
+     * @param thread_count The number of threads running the tasks, including the creating thread, so that thread_count - 1 workers are started
+     * @param pin_workers Pin each worker thread to one of the CPUs the process is allowed to run on, so that it keeps using the memory of its own NUMA
+     *                    node. Only supported on Linux.
+     */
+    explicit TaskScheduler(uint32_t thread_count = defaultThreadCount(), bool pin_workers = false);
+
+    /*!
+     * Creates the scheduler, which will run its workers on an external executor
+     * @param executor The executor to run the workers on, which must outlive the scheduler
+     * @param thread_count The number of threads running the tasks, including the creating thread. If 0, the concurrency of the executor is used for
+     *                     the workers.
+     */
+    explicit TaskScheduler(TaskExecutor& executor, uint32_t thread_count = 0);
+
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /*! @return The number of threads running the tasks, including the creating thread */
+    [[nodiscard]] uint32_t threadCount() const;
+
+    /*! @return The statistics of each thread, the first one being the creating thread */
+    [[nodiscard]] std::vector<WorkerStats> workerStats() const;
+
+    /*! @return The index of the calling thread in the scheduler that is running it, or 0 for threads that are not workers */
+    [[nodiscard]] static uint32_t currentThreadIndex();
+
+    /*!
+     * @return The number of threads to be used by default, which is the number of hardware threads available to the process, according to its CPU
+     *         affinity and cgroup CPU quota
+     */
+    [[nodiscard]] static uint32_t defaultThreadCount();
+
+    /*!
+     * Schedules a task to be run
+     * @param group The group the task belongs to
+     * @param task The task, which is not copied and should remain valid until the group has been waited for
+     */
+    void run(TaskGroup& group, Task& task);
+
+    /*!
+     * Waits for all the tasks of a group to be completed. The calling thread runs pending tasks meanwhile.
+     * @param group The group to be waited for
+     */
+    void wait(TaskGroup& group);
+
+    /*!
+     * Calls a function on consecutive sub-ranges of [0, count), in parallel, and waits for all of them to be completed
+     * @param count The size of the whole range
+     * @param grain_size The maximum size of the sub-ranges
+     * @param function The function to be called as function(begin, end) for each sub-range. It should not throw.
+     */
+    template<typename Function>
+    void parallelFor(size_t count, size_t grain_size, Function&& function);
+
+private:
+    class TaskDeque;
+    struct Worker;
+    struct ThreadCounters;
+    struct ExecutorState;
+
+    [[nodiscard]] uint32_t ownDequeIndex() const;
+
+    Task* findTask(uint32_t thread_index, uint32_t& steal_seed);
+
+    Task* spinForTask(uint32_t thread_index, uint32_t& steal_seed);
+
+    [[nodiscard]] bool hasTasks() const;
+
+    static void execute(Task* task);
+
+    void wakeWorker();
+
+    void workerThread(uint32_t thread_index, int32_t cpu);
+
+    void submitExecutorJob();
+
+    static void executorJob(void* user_data);
+
+    void runExecutorJob();
+
+    uint32_t claimExecutorSlot();
+
+private:
+    std::vector<std::unique_ptr<TaskDeque>> deques_; // One per thread, including the creating thread
+    std::unique_ptr<ThreadCounters[]> counters_; // One per thread, including the creating thread
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> shutdown_{ false };
+    std::mutex idle_mutex_;
+    std::vector<Worker*> idle_workers_;
+    std::atomic<uint32_t> idle_workers_count_{ 0 };
+
+    TaskExecutor* executor_{ nullptr };
+    std::unique_ptr<std::atomic<bool>[]> executor_slots_used_; // Whether each worker index is used by a running executor job
+    ExecutorState* executor_state_{ nullptr }; // Shared with the submitted jobs, which may outlive the scheduler in the queue of the executor
+};
+
+template<typename Function>
+void TaskScheduler::parallelFor(size_t count, size_t grain_size, Function&& function)
+{
+    grain_size = std::max(grain_size, size_t(1));
+    const size_t tasks_count = (count + grain_size - 1) / grain_size;
+    if (tasks_count <= 1 || threadCount() == 1)
+    {
+        if (count > 0)
+        {
+            function(size_t(0), count);
+        }
+        return;
+    }
+
+    struct Range
+    {
+        std::remove_reference_t<Function>* function;
+        size_t begin;
+        size_t end;
+    };
+
+    std::vector<Range> ranges(tasks_count);
+    std::vector<Task> tasks(tasks_count);
+    TaskGroup group;
+    for (size_t index = 0; index < tasks_count; ++index)
+    {
+        ranges[index] = Range{ .function = &function, .begin = index * grain_size, .end = std::min(count, (index + 1) * grain_size) };
+        tasks[index].function = [](void* user_data)
+        {
+            const Range* range = static_cast<const Range*>(user_data);
+            (*range->function)(range->begin, range->end);
+        };
+        tasks[index].user_data = &ranges[index];
+        run(group, tasks[index]);
+    }
+    wait(group);
+}
@@ -0,0 +1,87 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "UnwrapOptions.h"
+
+struct Face;
+struct Vertex;
+struct UnwrapResult;
+
+/*!
+ * On-disk cache of unwrapping results, addressed by the content of the input mesh and the options. A mesh that was already unwrapped is then loaded with a
+ * hash and a file mapping, instead of being unwrapped again.
+ *
+ * Each result is stored in its own file of the cache directory, whose modification time is refreshed when it is loaded. When the total size of the files
+ * exceeds the size cap, the least recently used ones are removed. Files are written atomically, so that several processes can share the same directory.
+ */
+class UnwrapCache
+{
+public:
+    /*!
+     * Creates the cache, and its directory if needed
+     * @param directory The directory containing the cached results
+     * @param max_size The maximum total size of the cached results, in bytes
+     */
+    UnwrapCache(std::filesystem::path directory, uintmax_t max_size);
+
+    /*!
+     * Loads the result of the unwrapping of a mesh from the cache, or unwraps it and stores the result in the cache, see ::smartUnwrap()
+     * @param vertices List containing the position of the input vertices
+     * @param faces List of faces composing the mesh
+     * @param result Output mesh with UV coordinates. When loaded from the cache, UnwrapStats::from_cache is set.
+     * @param options Options of the unwrapping. When the result is loaded from the cache, the callbacks are not called.
+     * @return True if the unwrapping succeeded
+     */
+    bool smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options = {});
+
+    /*!
+     * Calculates the key of a cached result, from the input mesh and the options that change the result
+     * @param vertices List containing the position of the input vertices
+     * @param faces List of faces composing the mesh
+     * @param options Options of the unwrapping
+     * @return The key of the result
+     */
+    [[nodiscard]] static uint64_t key(std::span<const Vertex> vertices, std::span<const Face> faces, const UnwrapOptions& options);
+
+    /*!
+     * Loads a result from the cache
+     * @param key The key of the result
+     * @param result The loaded result
+     * @return True if the result was found and valid
+     */
+    bool load(uint64_t key, UnwrapResult& result);
+
+    /*!
+     * Stores a result in the cache, then removes the least recently used results if the cache got too large
+     * @param key The key of the result
+     * @param result The result to be stored
+     * @return True if the result could be written
+     */
+    bool store(uint64_t key, const UnwrapResult& result);
+
+    /*! @return The directory containing the cached results */
+    [[nodiscard]] const std::filesystem::path& directory() const;
+
+    /*! @return The number of results loaded from the cache */
+    [[nodiscard]] uint64_t hits() const;
+
+    /*! @return The number of results that were not found in the cache */
+    [[nodiscard]] uint64_t misses() const;
+
+private:
+    [[nodiscard]] std::filesystem::path entryPath(uint64_t key) const;
+
+    void evict();
+
+private:
+    std::filesystem::path directory_;
+    uintmax_t max_size_;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+};
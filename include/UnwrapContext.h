@@ -0,0 +1,165 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+#include "MemoryTracker.h"
+#include "UnwrapOptions.h"
+#include "UnwrapStage.h"
+
+class TaskScheduler;
+
+/*!
+ * State shared by the stages of an unwrapping
+ */
+struct UnwrapContext
+{
+    const UnwrapOptions* options{ nullptr };
+    TaskScheduler* scheduler{ nullptr };
+    MemoryTracker* memory_tracker{ nullptr };
+    std::optional<UnwrapStage> current_stage;
+    std::chrono::steady_clock::time_point stage_start;
+    std::array<std::chrono::steady_clock::duration, unwrap_stage_count> stage_durations{}; // Time spent in each stage, accumulated over its entries
+    std::array<int, unwrap_stage_count> reported_percents{ unreportedPercents() }; // Last integer percentage of progress reported for each stage
+    bool alternating{ false }; // Whether the current stage is one of the stages switched with switchStage()
+    std::chrono::steady_clock::time_point switch_time; // When the current alternating stage was switched to
+    std::array<std::chrono::steady_clock::duration, unwrap_stage_count> alternating_durations{}; // Time spent in each alternating stage since the first switch
+    std::array<bool, unwrap_stage_count> alternated{}; // Whether each stage has been switched to since the first switch
+
+    /*!
+     * @return Whether the time spent in the stages is measured, which is skipped when neither the timings nor the memory are asked for
+     */
+    [[nodiscard]] bool timed() const
+    {
+        return options->timing_callback || memory_tracker != nullptr;
+    }
+
+    /*!
+     * Leaves the current stage, if any, and starts a new stage of the unwrapping
+     * @param stage The stage to be started
+     * @param progress The completed fraction of the stage
+     * @return False if the unwrapping has been cancelled
+     */
+    [[nodiscard]] bool enterStage(UnwrapStage stage, float progress = 0.0F)
+    {
+        leaveStage();
+        current_stage = stage;
+        if (timed())
+        {
+            stage_start = std::chrono::steady_clock::now();
+        }
+        if (memory_tracker != nullptr)
+        {
+            memory_tracker->enterStage(stage);
+        }
+        return reportProgress(stage, progress);
+    }
+
+    /*!
+     * Switches to one of stages that alternate many times, like the rasterization and placement of each chart. The switches are not reported as stage
+     * changes: the time spent in each of the alternating stages is accumulated, and reported once when leaving them.
+     * @param stage The stage to be switched to
+     * @param progress The completed fraction of the stage
+     * @return False if the unwrapping has been cancelled
+     */
+    [[nodiscard]] bool switchStage(UnwrapStage stage, float progress)
+    {
+        if (! alternating)
+        {
+            leaveStage();
+            alternating = true;
+            if (timed())
+            {
+                stage_start = std::chrono::steady_clock::now();
+                switch_time = stage_start;
+            }
+        }
+        else if (current_stage != stage && timed())
+        {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            alternating_durations[static_cast<size_t>(*current_stage)] += now - switch_time;
+            switch_time = now;
+        }
+        if (current_stage != stage)
+        {
+            current_stage = stage;
+            alternated[static_cast<size_t>(stage)] = true;
+            if (memory_tracker != nullptr)
+            {
+                memory_tracker->enterStage(stage);
+            }
+        }
+        return reportProgress(stage, progress);
+    }
+
+    /*!
+     * Leaves the current stage, if any, records and reports the time spent in it. Alternating stages are all left at once, and each one is reported
+     * as starting with the first of them, and lasting for its accumulated time.
+     */
+    void leaveStage()
+    {
+        if (alternating && timed())
+        {
+            alternating_durations[static_cast<size_t>(*current_stage)] += std::chrono::steady_clock::now() - switch_time;
+            for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+            {
+                if (alternated[stage])
+                {
+                    stage_durations[stage] += alternating_durations[stage];
+                    if (options->timing_callback)
+                    {
+                        options->timing_callback(static_cast<UnwrapStage>(stage), stage_start, stage_start + alternating_durations[stage]);
+                    }
+                }
+            }
+        }
+        if (alternating)
+        {
+            alternating = false;
+            alternating_durations = {};
+            alternated = {};
+        }
+        else if (current_stage.has_value() && timed())
+        {
+            const std::chrono::steady_clock::time_point stage_end = std::chrono::steady_clock::now();
+            stage_durations[static_cast<size_t>(*current_stage)] += stage_end - stage_start;
+            if (options->timing_callback)
+            {
+                options->timing_callback(*current_stage, stage_start, stage_end);
+            }
+        }
+        current_stage.reset();
+    }
+
+    /*!
+     * Reports the progress of the current stage, when its integer percentage changed since the last report
+     * @return False if the unwrapping has been cancelled
+     */
+    [[nodiscard]] bool reportProgress(UnwrapStage stage, float progress)
+    {
+        if (options->progress_callback)
+        {
+            const int percent = static_cast<int>(progress * 100.0F);
+            int& reported_percent = reported_percents[static_cast<size_t>(stage)];
+            if (percent != reported_percent)
+            {
+                reported_percent = percent;
+                options->progress_callback(stage, progress);
+            }
+        }
+        return ! options->stop_token.stop_requested();
+    }
+
+    /*!
+     * @return The percentages of progress of stages that have not reported any yet
+     */
+    static constexpr std::array<int, unwrap_stage_count> unreportedPercents()
+    {
+        std::array<int, unwrap_stage_count> reported_percents;
+        reported_percents.fill(-1);
+        return reported_percents;
+    }
+};
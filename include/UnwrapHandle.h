@@ -0,0 +1,56 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <future>
+#include <optional>
+#include <stop_token>
+
+#include "UnwrapResult.h"
+
+/*!
+ * Handle on an unwrapping running in the background, see smartUnwrapAsync()
+ */
+class UnwrapHandle
+{
+public:
+    UnwrapHandle(std::future<std::optional<UnwrapResult>> result, std::stop_source stop_source);
+
+    UnwrapHandle(UnwrapHandle&& other) noexcept = default;
+
+    UnwrapHandle& operator=(UnwrapHandle&& other) noexcept;
+
+    /*!
+     * Cancels the unwrapping if it is still running, and waits for it to be stopped
+     */
+    ~UnwrapHandle();
+
+    /*!
+     * Requests the unwrapping to be cancelled. It stops at the next cancellation point, then fails.
+     */
+    void cancel();
+
+    /*! @return True if the cancellation of the unwrapping has been requested */
+    [[nodiscard]] bool cancelled() const;
+
+    /*! @return True if the unwrapping is completed, so that get() doesn't block */
+    [[nodiscard]] bool ready() const;
+
+    /*!
+     * Waits for the unwrapping to be completed
+     */
+    void wait() const;
+
+    /*!
+     * Waits for the unwrapping to be completed and takes its result. Can only be called once.
+     * @return The result of the unwrapping, or nothing if it failed or was cancelled
+     */
+    std::optional<UnwrapResult> get();
+
+private:
+    void stop();
+
+private:
+    std::future<std::optional<UnwrapResult>> result_;
+    std::stop_source stop_source_;
+};
@@ -0,0 +1,39 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+
+#include "UnwrapStage.h"
+
+class TaskExecutor;
+
+struct UnwrapOptions
+{
+    size_t arena_size{ 0 }; // When not 0, the temporary allocations of the unwrapping are made in a block of this size, released at once at the end
+    uint32_t thread_count{ 0 }; // Number of threads to be used, including the calling one. If 0, use the CPUs available to the process, or the executor.
+    TaskExecutor* executor{ nullptr }; // When set, the parallel work is run on this executor, and no thread is started by the unwrapping
+    bool pin_threads{ false }; // Pin each worker thread to one of the CPUs available to the process. Ignored when using an executor.
+    bool track_memory{ false }; // Record the peak amount of temporary memory used, globally and for each stage, in the stats of the result
+    float angle_limit{ 20.0F }; // Maximum angle, in degrees, between the normals of the faces projected together. Lower values make more charts with less distortion.
+    uint32_t resolution{ 512 }; // Definition at which the charts are packed, before the texture is scaled up. Higher values pack more tightly, but more slowly.
+    uint32_t padding{ 0 }; // Number of texels left between the charts, at the packing resolution
+    bool brute_force{ false }; // Try all the locations of each chart instead of random ones, which packs better but much more slowly
+    bool create_image{ false }; // Fill UnwrapResult::atlas_image with the texels covered by each chart. Not stored in the cache, nor made by smartUnwrapFile().
+    uint32_t seed{ 0 }; // Seed of the random placement of the charts. The same input, options and seed give bitwise identical results, with any thread count.
+    std::stop_token stop_token; // When a stop is requested, the unwrapping is cancelled at the next stage, or during the packing, and fails
+
+    // Called by the thread running the unwrapping when entering a stage, then when the integer percentage of the stages that report their progress changes,
+    // with the completed fraction of the stage in [0, 1]. The rasterization and placement of the charts alternate, and both report the fraction of the
+    // charts already placed.
+    std::function<void(UnwrapStage stage, float progress)> progress_callback;
+
+    // Called by the thread running the unwrapping when leaving a stage, with the times at which the stage was entered and left. The rasterization and
+    // placement of the charts alternate, so they are reported once each after the last chart, as starting with the first chart and lasting for their
+    // accumulated time.
+    std::function<void(UnwrapStage stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)> timing_callback;
+};
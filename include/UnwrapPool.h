@@ -0,0 +1,93 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "Face.h"
+#include "MeshView.h"
+#include "TaskScheduler.h"
+#include "UnwrapHandle.h"
+#include "UnwrapOptions.h"
+#include "UnwrapResult.h"
+#include "Vertex.h"
+
+/*!
+ * Pool of threads running unwrappings in the background. The unwrappings are submitted from any thread, and run concurrently as tasks of a single
+ * scheduler, whose threads also run their parallel parts, so that many unwrappings don't start many threads. Their completion is signaled by a callback,
+ * or through an UnwrapHandle.
+ *
+ * Submitted unwrappings ignore the thread count, executor and thread pinning of their options, since they run on the threads of the pool.
+ */
+class UnwrapPool
+{
+public:
+    /*!
+     * Called once the unwrapping is completed, from one of the threads of the pool
+     * @param result The result of the unwrapping, or nothing if it failed or was cancelled. The worker statistics are not set.
+     */
+    using Completion = std::function<void(std::optional<UnwrapResult> result)>;
+
+    /*!
+     * Creates the pool and starts its threads
+     * @param thread_count The number of threads running the unwrappings. If 0, use the CPUs available to the process.
+     */
+    explicit UnwrapPool(uint32_t thread_count = 0);
+
+    /*!
+     * Cancels the unwrappings that are still pending or running, waits for their completion to be called, then stops the threads
+     */
+    ~UnwrapPool();
+
+    UnwrapPool(const UnwrapPool&) = delete;
+
+    UnwrapPool& operator=(const UnwrapPool&) = delete;
+
+    /*!
+     * Submits a mesh to be unwrapped in the background. The unwrapping is cancelled when a stop is requested on the returned source or the stop token of
+     * the options, then fails.
+     * @param mesh The mesh to be unwrapped, which is not copied and should remain valid until the completion is called
+     * @param options Options of the unwrapping. The callbacks are called from the threads of the pool.
+     * @param completion Called once the unwrapping is completed, failed or cancelled, from one of the threads of the pool. It should not throw.
+     * @return The source to request the cancellation of the unwrapping
+     */
+    std::stop_source submit(MeshView mesh, UnwrapOptions options, Completion completion);
+
+    /*!
+     * Submits a mesh to be unwrapped in the background, see smartUnwrapAsync()
+     * @param vertices List containing the position of the input vertices, which is kept until the end of the unwrapping
+     * @param faces List of faces composing the mesh, which is kept until the end of the unwrapping
+     * @param options Options of the unwrapping. The callbacks are called from the threads of the pool.
+     * @return The handle to wait for, and get, the result of the unwrapping
+     */
+    UnwrapHandle submit(std::vector<Vertex> vertices, std::vector<Face> faces, UnwrapOptions options = {});
+
+    /*! @return The number of threads running the unwrappings */
+    [[nodiscard]] uint32_t threadCount() const;
+
+private:
+    struct Job;
+
+    void dispatchThread();
+
+    static void runJob(void* user_data);
+
+private:
+    // The scheduler is driven by the dispatch thread, which only schedules the jobs, while its workers run them
+    TaskScheduler scheduler_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<std::unique_ptr<Job>> pending_jobs_; // Submitted jobs not yet given to the scheduler, protected by the mutex
+    std::list<std::unique_ptr<Job>> running_jobs_; // Only accessed by the dispatch thread
+    bool shutdown_{ false }; // Protected by the mutex
+    std::thread dispatch_thread_;
+};
@@ -0,0 +1,29 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Face.h"
+#include "PackedChart.h"
+#include "UVCoord.h"
+#include "UnwrapStats.h"
+
+struct UnwrapResult
+{
+    std::vector<UVCoord> uv_coords; // UV coordinates of the output vertices, in [0,1] range
+    std::vector<Face> faces; // Output faces, in the same order as the input faces, but indexing the output vertices
+    std::vector<uint32_t> vertex_xref; // Index of the input vertex each output vertex originates from
+    std::vector<int32_t> vertex_chart; // Index of the chart each output vertex belongs to, or -1 for the vertices of faces that could not be projected
+    std::vector<PackedChart> charts; // Charts of the output, with their location on the texture
+    std::vector<uint32_t> chart_faces; // Indices of the faces of all the charts, the ones of each chart being contiguous, @sa PackedChart::first_face
+    // When UnwrapOptions::create_image is set, the packed atlas at the packing definition, UnwrapStats::atlas_width by UnwrapStats::atlas_height texels,
+    // row 0 being at v = 0. Each texel is 0 when empty, otherwise the index of the covering chart combined with xatlas::kImageHasChartIndexBit, and
+    // xatlas::kImageIsBilinearBit or xatlas::kImageIsPaddingBit when it is only sampled by bilinear filtering or left as padding around the chart.
+    std::vector<uint32_t> atlas_image;
+    uint32_t texture_width{ 0 }; // Width to be used for the texture image
+    uint32_t texture_height{ 0 }; // Height to be used for the texture image
+    uint64_t uv_hash{ 0 }; // Hash of the UV coordinates, faces and texture size, to compare or cache results. Equal for bitwise identical results.
+    UnwrapStats stats; // Statistics about the unwrapping
+};
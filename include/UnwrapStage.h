@@ -0,0 +1,56 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+enum class UnwrapStage
+{
+    FacesData, // Calculation of the faces normals
+    ProjectionNormals, // Calculation of the best projection normals
+    Clustering, // Grouping of the faces by projection normal
+    Projection, // Projection of the groups of faces to raw UV coordinates
+    Welding, // Merging of the vertices having the same position
+    SplitCharts, // Splitting of the groups to groups of adjacent faces
+    AddUvMesh, // Registration of the UV mesh to xatlas
+    SetCharts, // Registration of the charts to xatlas
+    ChartsPreprocessing, // Preparation of the charts for packing, and estimation of their scale
+    Rasterization, // Rasterization of a chart to a bit image, alternating with its placement
+    Placement, // Search of the location of a chart on the texture image, alternating with the rasterization of the next chart
+    Output, // Building of the output mesh
+};
+
+static constexpr size_t unwrap_stage_count = static_cast<size_t>(UnwrapStage::Output) + 1;
+
+constexpr std::string_view unwrapStageName(UnwrapStage stage)
+{
+    switch (stage)
+    {
+    case UnwrapStage::FacesData:
+        return "faces data";
+    case UnwrapStage::ProjectionNormals:
+        return "projection normals";
+    case UnwrapStage::Clustering:
+        return "clustering";
+    case UnwrapStage::Projection:
+        return "projection";
+    case UnwrapStage::Welding:
+        return "welding";
+    case UnwrapStage::SplitCharts:
+        return "split charts";
+    case UnwrapStage::AddUvMesh:
+        return "add UV mesh";
+    case UnwrapStage::SetCharts:
+        return "set charts";
+    case UnwrapStage::ChartsPreprocessing:
+        return "charts preprocessing";
+    case UnwrapStage::Rasterization:
+        return "rasterization";
+    case UnwrapStage::Placement:
+        return "placement";
+    case UnwrapStage::Output:
+        return "output";
+    }
+    return "unknown";
+}
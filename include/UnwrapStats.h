@@ -0,0 +1,25 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "UnwrapStage.h"
+#include "WorkerStats.h"
+
+struct UnwrapStats
+{
+    bool from_cache{ false }; // Whether the result was loaded from an UnwrapCache, in which case only the charts count and utilization are set
+    uint32_t charts_count{ 0 }; // Number of charts packed in the atlas
+    float utilization{ 0.0F }; // Fraction of the texels of the atlas that are covered by charts, before scaling the texture up
+    uint32_t atlas_width{ 0 }; // Width of the atlas the charts were packed in, in texels at the packing resolution, before scaling the texture up
+    uint32_t atlas_height{ 0 }; // Height of the atlas the charts were packed in, in texels at the packing resolution, before scaling the texture up
+    size_t peak_memory{ 0 }; // Peak amount of temporary memory used by the unwrapping, in bytes. Only set if memory tracking was enabled.
+    std::array<size_t, unwrap_stage_count> stage_peak_memory{}; // Peak amount of temporary memory in use during each stage, in bytes
+    std::array<std::chrono::steady_clock::duration, unwrap_stage_count> stage_durations{}; // Time spent in each stage. Only set if a timing callback was given or memory tracking was enabled.
+    std::vector<WorkerStats> workers; // Statistics of each thread that ran the parallel parts, the first one being the calling thread
+};
@@ -0,0 +1,12 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstdint>
+
+struct WorkerStats
+{
+    uint64_t executed_tasks{ 0 }; // Number of tasks run by the thread, including the stolen ones
+    uint64_t stolen_tasks{ 0 }; // Number of tasks the thread has stolen from other threads
+    int32_t cpu{ -1 }; // CPU the thread is pinned to, or -1 if it is not pinned
+};
@@ -0,0 +1,27 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace allocation
+{
+
+using ReallocFunc = void* (*)(void* ptr, size_t size);
+using FreeFunc = void (*)(void* ptr);
+
+/*!
+ * Installs custom memory allocation functions, which are then used for all the temporary allocations of the unwrapping, including the ones made by xatlas.
+ * This should not be called while an unwrapping is running.
+ * @param realloc_func Function behaving like std::realloc, or nullptr to restore the default allocation functions
+ * @param free_func Function behaving like std::free. If nullptr, memory is freed by calling realloc_func with a size of 0
+ */
+void setAllocationFunctions(ReallocFunc realloc_func, FreeFunc free_func);
+
+/*!
+ * @return A memory resource that allocates through the installed allocation functions, or the default new/delete resource if none are installed
+ */
+std::pmr::memory_resource* defaultResource();
+
+}; // namespace allocation
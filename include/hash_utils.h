@@ -0,0 +1,21 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hash_utils
+{
+
+/*!
+ * Calculates the 64-bit XXH64 hash of a buffer. The input is consumed by 4 independent lanes of 8 bytes, so that the hashing runs at about the memory
+ * bandwidth. Hashes are the same on every little-endian platform.
+ * @param data The buffer to be hashed
+ * @param size The size of the buffer, in bytes
+ * @param seed The seed of the hash, which can be the hash of a previous buffer to hash several buffers together
+ * @return The hash of the buffer
+ */
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+}; // namespace hash_utils
@@ -0,0 +1,92 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+struct Face;
+struct UVCoord;
+struct Vertex;
+
+/*
+ * Raw binary files of meshes and UV coordinates, which can be memory-mapped and used in place. All the values are stored in the native byte order.
+ */
+namespace raw_files
+{
+
+static constexpr uint32_t mesh_magic = 0x314D5655; // "UVM1"
+static constexpr uint32_t uvs_magic = 0x31555655; // "UVU1"
+
+/*!
+ * Header of a raw mesh file, followed by the positions of the vertices, as 3 floats each, then by the faces, as 3 uint32 vertex indices each
+ */
+struct MeshHeader
+{
+    uint32_t magic{ mesh_magic };
+    uint32_t reserved{ 0 };
+    uint64_t vertices_count{ 0 };
+    uint64_t faces_count{ 0 };
+};
+
+/*!
+ * Header of a raw UV file, followed by the UV coordinates of the 3 corners of each face, as 2 floats each
+ */
+struct UvsHeader
+{
+    uint32_t magic{ uvs_magic };
+    uint32_t texture_width{ 0 };
+    uint32_t texture_height{ 0 };
+    uint32_t reserved{ 0 };
+    uint64_t faces_count{ 0 };
+};
+
+/*!
+ * @return The size of a raw mesh file containing the given numbers of vertices and faces, in bytes. The counts have to be checked against the size
+ *         of the file beforehand, as the calculation overflows for counts that don't fit in memory.
+ */
+size_t meshFileSize(uint64_t vertices_count, uint64_t faces_count);
+
+/*!
+ * @return The size of a raw UV file for the given number of faces, in bytes
+ */
+size_t uvsFileSize(uint64_t faces_count);
+
+/*!
+ * Checks that a buffer holds a valid raw mesh, and views its content
+ * @param data The content of the file
+ * @param size The size of the file, in bytes
+ * @param vertices The positions of the vertices, viewed in the buffer
+ * @param faces The faces, viewed in the buffer
+ * @return True if the buffer holds a valid raw mesh
+ */
+bool viewMesh(const char* data, size_t size, std::span<const Vertex>& vertices, std::span<const Face>& faces);
+
+/*!
+ * Writes a raw mesh file
+ * @param path The path of the file to be written
+ * @param vertices The positions of the vertices
+ * @param faces The faces, indexing the vertices
+ * @return True if the file could be written
+ */
+bool writeMesh(const std::filesystem::path& path, std::span<const Vertex> vertices, std::span<const Face> faces);
+
+/*!
+ * Writes a raw UV file
+ * @param path The path of the file to be written
+ * @param texture_width The width of the texture image
+ * @param texture_height The height of the texture image
+ * @param uv_coords The UV coordinates of the vertices
+ * @param faces The faces, indexing the UV coordinates, whose corners are written in order
+ * @return True if the file could be written
+ */
+bool writeUvs(
+    const std::filesystem::path& path,
+    uint32_t texture_width,
+    uint32_t texture_height,
+    std::span<const UVCoord> uv_coords,
+    std::span<const Face> faces);
+
+}; // namespace raw_files
@@ -0,0 +1,162 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+/*
+ * Trace zones, enabled by the WITH_TRACING CMake option. They are then recorded with Tracy when it is available, or else written as a Chrome trace-event
+ * JSON file when the process exits, to the path set by the UVULA_TRACE_FILE environment variable, or uvula_trace.json. Without the option, the macros
+ * compile to nothing.
+ *
+ * UVULA_TRACE_ZONE(name) records the time spent until the end of the enclosing scope.
+ * UVULA_TRACE_TOTAL(name) accumulates the time spent until the end of the enclosing scope, for functions that are called too often to record each call,
+ * and UVULA_TRACE_EMIT_TOTAL(name) records and resets the accumulated time and number of calls. Names must be string literals.
+ */
+
+#if defined(UVULA_TRACING_TRACY) || defined(UVULA_TRACING_CHROME)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef UVULA_TRACING_TRACY
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace trace
+{
+
+/*!
+ * Time accumulated by the calls to a function
+ */
+class Total
+{
+public:
+    struct Values
+    {
+        uint64_t calls{ 0 };
+        double milliseconds{ 0.0 };
+    };
+
+    void add(std::chrono::steady_clock::duration duration)
+    {
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        nanoseconds_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+    }
+
+    /*! @return The accumulated values, which are then reset */
+    Values take()
+    {
+        return Values{ .calls = calls_.exchange(0, std::memory_order_relaxed),
+                       .milliseconds = static_cast<double>(nanoseconds_.exchange(0, std::memory_order_relaxed)) / 1.0e6 };
+    }
+
+private:
+    std::atomic<uint64_t> calls_{ 0 };
+    std::atomic<int64_t> nanoseconds_{ 0 };
+};
+
+/*!
+ * @param name The name of the total
+ * @return The total of the given name, which is created on first use and lives until the end of the process
+ */
+Total& total(const char* name);
+
+/*!
+ * Adds the time spent in its scope to a total
+ */
+class TotalScope
+{
+public:
+    explicit TotalScope(Total& total)
+        : total_(total)
+        , start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~TotalScope()
+    {
+        total_.add(std::chrono::steady_clock::now() - start_);
+    }
+
+    TotalScope(const TotalScope&) = delete;
+
+    TotalScope& operator=(const TotalScope&) = delete;
+
+private:
+    Total& total_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifdef UVULA_TRACING_CHROME
+/*!
+ * Records a complete event
+ * @param name The name of the event, which must live until the end of the process
+ * @param start The time at which the event started
+ * @param end The time at which the event ended
+ */
+void recordZone(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+/*!
+ * Records the values of a total as a counter event
+ * @param name The name of the counter, which must live until the end of the process
+ * @param values The values to be recorded
+ */
+void recordCounter(const char* name, const Total::Values& values);
+
+/*!
+ * Records the time spent in its scope
+ */
+class Zone
+{
+public:
+    explicit Zone(const char* name)
+        : name_(name)
+        , start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~Zone()
+    {
+        recordZone(name_, start_, std::chrono::steady_clock::now());
+    }
+
+    Zone(const Zone&) = delete;
+
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+};
+#endif
+
+}; // namespace trace
+
+#define UVULA_TRACE_CONCAT_IMPL(a, b) a##b
+#define UVULA_TRACE_CONCAT(a, b) UVULA_TRACE_CONCAT_IMPL(a, b)
+
+#define UVULA_TRACE_TOTAL(name) \
+    static trace::Total& UVULA_TRACE_CONCAT(uvula_trace_total_, __LINE__) = trace::total(name); \
+    const trace::TotalScope UVULA_TRACE_CONCAT(uvula_trace_total_scope_, __LINE__)(UVULA_TRACE_CONCAT(uvula_trace_total_, __LINE__))
+
+#ifdef UVULA_TRACING_TRACY
+#define UVULA_TRACE_ZONE(name) ZoneScopedN(name)
+#define UVULA_TRACE_EMIT_TOTAL(name) \
+    do \
+    { \
+        const trace::Total::Values uvula_trace_values = trace::total(name).take(); \
+        TracyPlot(name " calls", static_cast<int64_t>(uvula_trace_values.calls)); \
+        TracyPlot(name " ms", uvula_trace_values.milliseconds); \
+    } while (false)
+#else
+#define UVULA_TRACE_ZONE(name) const trace::Zone UVULA_TRACE_CONCAT(uvula_trace_zone_, __LINE__)(name)
+#define UVULA_TRACE_EMIT_TOTAL(name) trace::recordCounter(name, trace::total(name).take())
+#endif
+
+#else
+
+#define UVULA_TRACE_ZONE(name)
+#define UVULA_TRACE_TOTAL(name)
+#define UVULA_TRACE_EMIT_TOTAL(name)
+
+#endif
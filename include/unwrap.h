@@ -2,20 +2,95 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
 #include <vector>
 
+#include "UnwrapOptions.h"
+
 struct Face;
+struct MeshView;
 struct Vertex;
 struct UVCoord;
+struct UnwrapResult;
+class UnwrapHandle;
+
+/*!
+ * Groups, projects and packs the faces of the input mesh to non-overlapping and properly distributed UV coordinates patches
+ * @param vertices List containing the position of the input vertices
+ * @param faces List of faces composing the mesh
+ * @param result Output mesh with UV coordinates. Vertices that are shared by several patches are split, so that each of them gets its own UV coordinates
+ * @param options Options of the unwrapping
+ * @return True if the unwrapping succeeded
+ */
+bool smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options = {});
+
+/*!
+ * Unwraps several meshes in parallel, see smartUnwrap(). The threads are started once and shared by all the meshes, each of them being processed as a task
+ * whose parallel parts are run by the same threads.
+ * @param meshes The vertices and faces of each mesh
+ * @param options Options of the unwrappings, which are the same for all the meshes. The callbacks may be called concurrently for different meshes.
+ * @return The result of each mesh, or nothing for the meshes whose unwrapping failed or was cancelled. The worker statistics are not set.
+ */
+std::vector<std::optional<UnwrapResult>> smartUnwrapMany(std::span<const MeshView> meshes, const UnwrapOptions& options = {});
+
+/*!
+ * Starts unwrapping the input mesh in the background, see smartUnwrap(). The unwrapping can be cancelled through the returned handle, or through the stop
+ * token of the options, and is cancelled when the handle is destroyed. It is run as a job of the executor of the options when set, so that no thread is
+ * started, in which case the handle should not be waited for, nor destroyed, from a thread of the executor before the job started. Otherwise, a thread is
+ * started for the unwrapping.
+ * @param vertices List containing the position of the input vertices, which is kept until the end of the unwrapping
+ * @param faces List of faces composing the mesh, which is kept until the end of the unwrapping
+ * @param options Options of the unwrapping. The progress callback is called from the background thread, or the thread of the executor.
+ * @return The handle to wait for, and get, the result of the unwrapping
+ */
+UnwrapHandle smartUnwrapAsync(std::vector<Vertex> vertices, std::vector<Face> faces, UnwrapOptions options = {});
 
 /*!
  * Groups, projects and packs the faces of the input mesh to non-overlapping and properly distributed UV coordinates patches
  * @param vertices List containing the position of the input vertices
  * @param faces List of faces composing the mesh
- * @param uv_coords Output list of UV coordinates, which should be pre-sized to the same size as the vertices
+ * @param uv_coords Output list of UV coordinates, which should be pre-sized to the same size as the vertices. A vertex shared by several patches can only
+ *                  store the UV coordinates of one of them, so use the UnwrapResult version for meshes with shared vertices.
  * @param texture_width Output width to be used for the texture image
  * @param texture_height Output height to be used for the texture image
- * @return
+ * @return True if the unwrapping succeeded
+ */
+bool smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, std::vector<UVCoord>& uv_coords, uint32_t& texture_width, uint32_t& texture_height);
+
+/*!
+ * Unwraps a mesh stored in a raw mesh file, which may be larger than the available memory, see smartUnwrap(). The mesh is streamed from the memory-mapped
+ * file: the faces are grouped by projection normal in a first pass over a sample of them, then spilled to temporary files next to the output file, grouped
+ * by normal and by region of space. The groups are unwrapped and packed in batches whose size is set by the memory budget, then the atlases of the batches
+ * are laid out on the texture.
+ * @param input_path The path of the raw mesh file, @sa raw_files::MeshHeader
+ * @param output_path The path of the raw UV file to be written, holding the UV coordinates of the corners of each face, @sa raw_files::UvsHeader
+ * @param memory_budget The amount of memory the unwrapping should use, besides the mapped files, in bytes. It is a target rather than a hard limit.
+ * @param result Output texture size, hash of the written UV coordinates and statistics. The UV coordinates, faces and charts are not set.
+ * @param options Options of the unwrapping. The arena size is ignored.
+ * @return True if the unwrapping succeeded and the output file has been written
+ */
+bool smartUnwrapFile(
+    const std::filesystem::path& input_path,
+    const std::filesystem::path& output_path,
+    size_t memory_budget,
+    UnwrapResult& result,
+    const UnwrapOptions& options = {});
+
+/*!
+ * Estimates the peak amount of temporary memory that an unwrapping will use, before starting it
+ * @param vertex_count The number of vertices of the mesh to be unwrapped
+ * @param face_count The number of faces of the mesh to be unwrapped
+ * @return The estimated peak memory, in bytes. It does not include the memory of the result.
+ */
+size_t estimateUnwrapMemory(size_t vertex_count, size_t face_count);
+
+/*!
+ * Calculates the hash of the UV coordinates, faces and texture size of a result, as stored in UnwrapResult::uv_hash
+ * @param result The result to be hashed
+ * @return The hash, which is the same for bitwise identical results on every little-endian platform
  */
-bool smartUnwrap(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, std::vector<UVCoord>& uv_coords, uint32_t& texture_width, uint32_t& texture_height);
\ No newline at end of file
+uint64_t calculateUvHash(const UnwrapResult& result);
@@ -0,0 +1,152 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#pragma once
+
+/*
+ * Stages of the unwrapping, which are internal to the library and only exposed to be benchmarked separately, @sa smartUnwrap()
+ */
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Face.h"
+#include "FaceData.h"
+#include "UVCoord.h"
+#include "UnwrapContext.h"
+#include "Vector.h"
+#include "Vertex.h"
+#include "xatlas.h"
+
+class TaskScheduler;
+struct UnwrapResult;
+
+/*!
+ * Creates the scheduler running the parallel work of the unwrapping
+ * @param scheduler The created scheduler
+ * @param options Options of the unwrapping, giving the thread count, executor and thread pinning
+ */
+void makeScheduler(std::optional<TaskScheduler>& scheduler, const UnwrapOptions& options);
+
+// Packing options of the unwrapping. Using a small calculation definition makes the packing much faster and adds more margin between the charts, then
+// the result is scaled up.
+static constexpr xatlas::PackOptions default_pack_options{ .padding = 0, .resolution = 512 };
+
+// Size of the longest side of the texture, to which the packing is scaled up
+static constexpr uint32_t texture_definition = 4096;
+
+/*!
+ * Calculates the normals of the faces, and discards the ones that can not be projected
+ * @param vertices The list of vertices positions
+ * @param faces The list of faces
+ * @param scheduler The scheduler to run the parallel parts on
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return The data of the faces that have a valid normal, in the order of the faces
+ */
+std::pmr::vector<FaceData> makeFacesData(std::span<const Vertex> vertices, std::span<const Face> faces, TaskScheduler& scheduler, std::pmr::memory_resource* resource);
+
+/*!
+ * Calculate the best projection normals according to the given input faces
+ * @param faces_data The faces data
+ * @param angle_limit The maximum angle between the normals of the faces projected along the same normal, in degrees, @sa UnwrapOptions::angle_limit
+ * @param scheduler The scheduler to run the parallel parts on
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return A list of normals that are far enough from each other
+ */
+std::pmr::vector<Vector>
+    calculateProjectionNormals(const std::pmr::vector<FaceData>& faces_data, float angle_limit, TaskScheduler& scheduler, std::pmr::memory_resource* resource);
+
+/*!
+ * Groups the faces by the projection normal that is the closest to their own normal
+ * @param faces_data The data of the faces that can be projected, @sa makeFacesData()
+ * @param project_normal_array The normals to project the faces along, @sa calculateProjectionNormals()
+ * @param scheduler The scheduler to run the parallel parts on
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return The faces grouped by projection normal, in the same order as the normals, which may contain empty groups
+ */
+std::pmr::vector<std::pmr::vector<const FaceData*>> groupFacesByProjectionNormal(
+    const std::pmr::vector<FaceData>& faces_data,
+    const std::pmr::vector<Vector>& project_normal_array,
+    TaskScheduler& scheduler,
+    std::pmr::memory_resource* resource);
+
+/*!
+ * Projects the points of the groups of faces as raw UV coordinates along their normal
+ * @param vertices The list of vertices positions
+ * @param faces The list of faces we want to project
+ * @param faces_data The data of the faces that can be projected, @sa makeFacesData()
+ * @param project_normal_array The normals to project the faces along, @sa calculateProjectionNormals()
+ * @param projected_faces_groups The faces grouped by projection normal, @sa groupFacesByProjectionNormal()
+ * @param uv_coords Output raw UV coordinates, that overlap and are not in the [0,1] range. A vertex used by faces of different groups gets one UV
+ *                  coordinate per group, so there may be more UV coordinates than vertices.
+ * @param uv_faces Output faces, which are the input faces but indexing the UV coordinates
+ * @param uv_xref Output index of the input vertex for each UV coordinate
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return A list containing grouped indices of faces
+ */
+std::pmr::vector<std::pmr::vector<size_t>> makeCharts(
+    std::span<const Vertex> vertices,
+    std::span<const Face> faces,
+    const std::pmr::vector<FaceData>& faces_data,
+    const std::pmr::vector<Vector>& project_normal_array,
+    const std::pmr::vector<std::pmr::vector<const FaceData*>>& projected_faces_groups,
+    std::pmr::vector<UVCoord>& uv_coords,
+    std::pmr::vector<Face>& uv_faces,
+    std::pmr::vector<uint32_t>& uv_xref,
+    std::pmr::memory_resource* resource);
+
+/*!
+ * When loading the mesh, each vertex of each triangle is given a unique index, even if it is used in multiple adjacent triangles. The purpose
+ * of this function is to remove double vertices so that we can make adjacency detection easier.
+ * @param faces The original list of faces
+ * @param vertices The original list of vertices position
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return The modified list of faces, which contains as many faces but with merged vertices
+ */
+std::pmr::vector<Face> groupSimilarVertices(std::span<const Face> faces, std::span<const Vertex> vertices, std::pmr::memory_resource* resource);
+
+/*!
+ * When projecting faces groups along a normal, it is possible that we project faces that are actually far away from each other spatially. This sometimes
+ * results in overlapping projections, which we really want to avoid. The purpose of this function is to make sub-groups of faces groups for faces that are
+ * adjacent to each other.
+ * @param grouped_faces Contains the grouped indices of faces
+ * @param faces The actual faces definitions, whose vertices should have been merged before, @sa groupSimilarVertices()
+ * @param resource The memory resource to be used for the temporary and returned containers
+ * @return Grouped faces with groups containing only adjacent faces. It may be identical to the original groups, or contain more smaller groups
+ */
+std::pmr::vector<std::pmr::vector<size_t>>
+    splitNonLinkedFacesCharts(const std::pmr::vector<std::pmr::vector<size_t>>& grouped_faces, const std::pmr::vector<Face>& faces, std::pmr::memory_resource* resource);
+
+/*!
+ * Packs the charts (faces groups) onto a texture image by using as much space as possible without having them overlap
+ * @param context The context of the unwrapping
+ * @param uv_faces The list of faces, indexing the UV coordinates
+ * @param charts The list of grouped faces indices
+ * @param uv_coords The raw UV coordinates, which may be overlapping and not fitting on an image
+ * @param uv_xref The index of the input vertex for each UV coordinate
+ * @param result Output mesh, containing the UV coordinates properly scaled and distributed on the image. Vertices that are shared between charts
+ *               are split by the packing, so there may be more output vertices than raw UV coordinates.
+ * @param pack_options The options of the packing, @sa default_pack_options
+ * @return True if the packing succeeded
+ */
+bool packCharts(
+    UnwrapContext& context,
+    const std::pmr::vector<Face>& uv_faces,
+    const std::pmr::vector<std::pmr::vector<size_t>>& charts,
+    const std::pmr::vector<UVCoord>& uv_coords,
+    const std::pmr::vector<uint32_t>& uv_xref,
+    UnwrapResult& result,
+    const xatlas::PackOptions& pack_options);
+
+/*!
+ * Unwraps a mesh on an existing scheduler, see smartUnwrap()
+ * @param vertices List containing the position of the input vertices
+ * @param faces List of faces composing the mesh
+ * @param result Output mesh with UV coordinates. The worker statistics are not set.
+ * @param options Options of the unwrapping, whose thread count, executor and thread pinning are ignored
+ * @param scheduler The scheduler to run the parallel parts on, which may be running other unwrappings at the same time
+ * @return True if the unwrapping succeeded
+ */
+bool unwrapMesh(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options, TaskScheduler& scheduler);
@@ -31,8 +31,11 @@ Copyright NVIDIA Corporation 2006 -- Ignacio Castano <icastano@nvidia.com>
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <memory_resource>
 #include <vector>
 
+class TaskScheduler;
+
 namespace xatlas
 {
 
@@ -43,6 +46,7 @@ struct Chart
     uint32_t atlasIndex; // Sub-atlas index.
     uint32_t faceCount;
     uint32_t material;
+    bool rotated; // Rotated by 90 degrees when packed.
 };
 
 // Output vertex.
@@ -65,10 +69,16 @@ struct Mesh
     uint32_t vertexCount;
 };
 
+// Atlas image texel flags, see Atlas::image.
+static const uint32_t kImageChartIndexMask = 0x1FFFFFFF;
+static const uint32_t kImageHasChartIndexBit = 0x80000000;
+static const uint32_t kImageIsBilinearBit = 0x40000000;
+static const uint32_t kImageIsPaddingBit = 0x20000000;
+
 // Empty on creation. Populated after charts are packed.
 struct Atlas
 {
-    uint32_t* image;
+    uint32_t* image; // Packed atlas images, atlasCount * width * height texels. Only set if PackOptions::createImage is true.
     Mesh* meshes; // The output meshes, corresponding to each AddMesh call.
     float* utilization; // Normalized atlas texel utilization array. E.g. a value of 0.8 means 20% empty space. atlasCount in length.
     uint32_t width; // Atlas width in texels.
@@ -79,8 +89,8 @@ struct Atlas
     float texelsPerUnit; // Equal to PackOptions texelsPerUnit if texelsPerUnit > 0, otherwise an estimated value to match PackOptions resolution.
 };
 
-// Create an empty atlas.
-Atlas* Create();
+// Create an empty atlas. If a task scheduler is given, it is used instead of creating one, and must outlive the atlas.
+Atlas* Create(::TaskScheduler* taskScheduler = nullptr);
 
 void Destroy(Atlas* atlas);
 
@@ -113,7 +123,9 @@ struct UvMeshDecl
 
 AddMeshError AddUvMesh(Atlas* atlas, const UvMeshDecl& decl);
 
-void SetCharts(Atlas* atlas, const std::vector<std::vector<size_t>>& grouped_faces);
+// Use the given groups of face indices as charts. A face can only belong to one chart, vertices shared by faces of different charts are split, so the
+// output meshes may have more vertices than the input ones, see PlacedVertex::xref.
+void SetCharts(Atlas* atlas, const std::pmr::vector<std::pmr::vector<size_t>>& grouped_faces);
 
 struct PackOptions
 {
@@ -147,9 +159,49 @@ struct PackOptions
 
     // Rotate charts to improve packing.
     bool rotateCharts = true;
+
+    // Create Atlas::image, giving the index of the chart covering each texel, and whether the texel is only sampled by bilinear filtering or padding.
+    bool createImage = false;
+
+    // Seed of the random chart placement. The placement only depends on the charts, the options and this seed, not on the number of threads.
+    uint32_t seed = 0;
 };
 
 // Call after ComputeCharts. Can be called multiple times to re-pack charts with different options.
 void PackCharts(Atlas* atlas, PackOptions packOptions = PackOptions());
 
+// Progress tracking.
+enum class ProgressCategory
+{
+    PrepareCharts,
+    RasterizeCharts, // Reported before rasterizing each chart, alternating with PlaceCharts.
+    PlaceCharts, // Reported before placing each chart.
+    BuildOutputMeshes
+};
+
+const char* StringForEnum(ProgressCategory category);
+
+// May be called from any thread. Return false to cancel.
+typedef bool (*ProgressFunc)(ProgressCategory category, int progress, void* userData);
+
+void SetProgressCallback(Atlas* atlas, ProgressFunc progressFunc = nullptr, void* progressUserData = nullptr);
+
+// Custom memory allocation.
+typedef void* (*ReallocFunc)(void*, size_t);
+typedef void (*FreeFunc)(void*);
+void SetAlloc(ReallocFunc reallocFunc, FreeFunc freeFunc = nullptr); // Pass nullptr to restore realloc and free.
+
+// Allocation callbacks with user data, overriding the SetAlloc functions for a single thread.
+struct AllocCallbacks
+{
+    void* (*realloc)(void* userData, void* ptr, size_t size);
+    void (*free)(void* userData, void* ptr); // Optional.
+    void* userData;
+};
+
+// Use the given callbacks for all the allocations made by the calling thread, including the ones of the tasks it runs on the atlas task scheduler, or nullptr
+// to use the SetAlloc functions again. Memory allocated with the callbacks must be freed while they are still set, so they should surround the whole lifetime
+// of an atlas, from Create to Destroy. Returns the previous callbacks.
+const AllocCallbacks* SetThreadAlloc(const AllocCallbacks* callbacks);
+
 } // namespace xatlas
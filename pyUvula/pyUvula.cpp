@@ -1,49 +1,450 @@
 ﻿// (c) 2025, UltiMaker -- see LICENCE for details
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 
 #include "Face.h"
+#include "MeshView.h"
+#include "PackedChart.h"
 #include "UVCoord.h"
+#include "UnwrapOptions.h"
+#include "UnwrapPool.h"
+#include "UnwrapResult.h"
+#include "UnwrapStage.h"
+#include "UnwrapStats.h"
 #include "Vertex.h"
 #include "unwrap.h"
 
 namespace py = pybind11;
 
-py::tuple unwrap(const py::array_t<float>& vertices_array, const py::array_t<int32_t>& indices_array)
+// The numpy buffers are viewed as arrays of vertices and faces
+static_assert(sizeof(Vertex) == 3 * sizeof(float));
+static_assert(sizeof(Face) == 3 * sizeof(uint32_t));
+static_assert(sizeof(UVCoord) == 2 * sizeof(float));
+
+using VerticesArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+using IndicesArray = py::array_t<uint32_t, py::array::c_style | py::array::forcecast>;
+
+static void checkShape(const py::array& array, const char* name)
+{
+    if (array.ndim() != 2 || array.shape(1) != 3)
+    {
+        throw py::value_error(std::string(name) + " should be an array of shape (N, 3)");
+    }
+}
+
+/*!
+ * @return The vertices as a C-contiguous float32 array, which is the given array itself if it already is one, or else a converted copy, e.g. of a float64
+ *         array
+ */
+static VerticesArray verticesArray(const py::array& array)
+{
+    checkShape(array, "vertices");
+    if (array.dtype().kind() != 'f')
+    {
+        throw py::type_error("vertices should be an array of floating-point numbers");
+    }
+    VerticesArray vertices = VerticesArray::ensure(array);
+    if (! vertices)
+    {
+        throw py::type_error("vertices can not be converted to float32");
+    }
+    return vertices;
+}
+
+/*!
+ * Checks that the indices of an array of integers wider than 32 bits are in the range of the vertices, before they are converted to uint32, which would
+ * silently wrap the ones above 2^32
+ */
+template<typename Index>
+static void checkWideIndices(const py::array& array, size_t vertices_count)
+{
+    using WideArray = py::array_t<Index, py::array::c_style | py::array::forcecast>;
+    const WideArray wide_indices = WideArray::ensure(array);
+    if (! wide_indices)
+    {
+        throw py::type_error("indices can not be converted to uint32");
+    }
+    const Index* data = wide_indices.data();
+    if (std::any_of(
+            data,
+            data + wide_indices.size(),
+            [vertices_count](Index index)
+            {
+                if constexpr (std::is_signed_v<Index>)
+                {
+                    if (index < 0)
+                    {
+                        return true;
+                    }
+                }
+                return static_cast<uint64_t>(index) >= vertices_count;
+            }))
+    {
+        throw py::value_error("indices should be in the range of the vertices");
+    }
+}
+
+/*!
+ * @return The indices as a C-contiguous uint32 array, which is the given array itself if it already is one, or else a converted copy, e.g. of an int32 or
+ *         int64 array
+ */
+static IndicesArray indicesArray(const py::array& array, size_t vertices_count)
+{
+    checkShape(array, "indices");
+    if (array.dtype().kind() != 'i' && array.dtype().kind() != 'u')
+    {
+        throw py::type_error("indices should be an array of integers");
+    }
+
+    // Wider indices are checked before their conversion, smaller ones after it, negative ones being converted to values out of range
+    const bool wide = array.dtype().itemsize() > static_cast<py::ssize_t>(sizeof(uint32_t));
+    if (wide)
+    {
+        if (array.dtype().kind() == 'i')
+        {
+            checkWideIndices<int64_t>(array, vertices_count);
+        }
+        else
+        {
+            checkWideIndices<uint64_t>(array, vertices_count);
+        }
+    }
+
+    IndicesArray indices = IndicesArray::ensure(array);
+    if (! indices)
+    {
+        throw py::type_error("indices can not be converted to uint32");
+    }
+    const uint32_t* data = indices.data();
+    if (! wide
+        && std::any_of(
+            data,
+            data + indices.size(),
+            [vertices_count](uint32_t index)
+            {
+                return index >= vertices_count;
+            }))
+    {
+        throw py::value_error("indices should be in the range of the vertices");
+    }
+    return indices;
+}
+
+template<typename Element, typename Array>
+static std::span<const Element> view(const Array& array)
+{
+    return std::span<const Element>(reinterpret_cast<const Element*>(array.data()), static_cast<size_t>(array.shape(0)));
+}
+
+/*!
+ * Input mesh given from Python. The arrays are kept alive while their buffers are used by the unwrapping.
+ */
+struct MeshInput
+{
+    VerticesArray vertices_array;
+    IndicesArray indices_array;
+
+    MeshInput(const py::array& vertices, const py::array& indices)
+        : vertices_array(verticesArray(vertices))
+        , indices_array(indicesArray(indices, static_cast<size_t>(vertices_array.shape(0))))
+    {
+    }
+
+    [[nodiscard]] MeshView view() const
+    {
+        return MeshView{ .vertices = ::view<Vertex>(vertices_array), .faces = ::view<Face>(indices_array) };
+    }
+};
+
+using UVsArray = py::array_t<float, py::array::c_style>;
+
+/*!
+ * Writes the UV coordinates of a result to the output array of the input vertices. Split vertices can only store one of their UV coordinates.
+ */
+static void writeUVs(const UnwrapResult& result, UVCoord* uvs_data, size_t vertices_count)
+{
+    std::fill(uvs_data, uvs_data + vertices_count, UVCoord{ .u = 0.0F, .v = 0.0F });
+    for (size_t index = 0; index < result.uv_coords.size(); ++index)
+    {
+        uvs_data[result.vertex_xref[index]] = result.uv_coords[index];
+    }
+}
+
+/*!
+ * @return The statistics of an unwrapping, as a dictionary
+ */
+static py::dict statsDict(const UnwrapStats& stats)
+{
+    py::dict stage_times;
+    py::dict stage_peak_memory;
+    for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+    {
+        const py::str stage_name(std::string(unwrapStageName(static_cast<UnwrapStage>(stage))));
+        stage_times[stage_name] = std::chrono::duration<double>(stats.stage_durations[stage]).count();
+        stage_peak_memory[stage_name] = stats.stage_peak_memory[stage];
+    }
+
+    py::dict dict;
+    dict["charts_count"] = stats.charts_count;
+    dict["utilization"] = stats.utilization;
+    dict["peak_memory"] = stats.peak_memory;
+    dict["stage_times"] = std::move(stage_times);
+    dict["stage_peak_memory"] = std::move(stage_peak_memory);
+    return dict;
+}
+
+/*!
+ * @return The charts of an unwrapping, as a dictionary of arrays. The chart of each input vertex is the one of the output vertex whose UV coordinates were
+ *         kept for it, see writeUVs().
+ */
+static py::dict chartsDict(const UnwrapResult& result, size_t vertices_count)
 {
-    // input shaping
-    const pybind11::buffer_info vertices_buf = vertices_array.request();
-    const pybind11::buffer_info indices_buf = indices_array.request();
-    if (vertices_buf.ndim != 2 || indices_buf.ndim != 2)
+    py::array_t<int32_t> vertex_charts(static_cast<py::ssize_t>(vertices_count));
+    int32_t* vertex_charts_data = vertex_charts.mutable_data();
+    std::fill(vertex_charts_data, vertex_charts_data + vertices_count, -1);
+    for (size_t index = 0; index < result.vertex_chart.size(); ++index)
+    {
+        vertex_charts_data[result.vertex_xref[index]] = result.vertex_chart[index];
+    }
+
+    const auto charts_count = static_cast<py::ssize_t>(result.charts.size());
+    py::array_t<uint32_t> faces(static_cast<py::ssize_t>(result.chart_faces.size()), result.chart_faces.data());
+    py::array_t<uint32_t> face_offsets(charts_count + 1);
+    py::array_t<uint32_t> rects({ charts_count, py::ssize_t(4) });
+    py::array_t<bool> rotated(charts_count);
+    auto face_offsets_data = face_offsets.mutable_unchecked<1>();
+    auto rects_data = rects.mutable_unchecked<2>();
+    auto rotated_data = rotated.mutable_unchecked<1>();
+    for (py::ssize_t index = 0; index < charts_count; ++index)
     {
-        throw std::runtime_error("Vertices should be <float, float, float> and indices should be (grouped by face as) <int, int, int>.");
+        const PackedChart& chart = result.charts[index];
+        face_offsets_data(index) = chart.first_face;
+        rects_data(index, 0) = chart.x;
+        rects_data(index, 1) = chart.y;
+        rects_data(index, 2) = chart.width;
+        rects_data(index, 3) = chart.height;
+        rotated_data(index) = chart.rotated;
     }
+    face_offsets_data(charts_count) = static_cast<uint32_t>(result.chart_faces.size());
+
+    py::dict dict;
+    dict["vertex_charts"] = std::move(vertex_charts);
+    dict["faces"] = std::move(faces);
+    dict["face_offsets"] = std::move(face_offsets);
+    dict["rects"] = std::move(rects);
+    dict["rotated"] = std::move(rotated);
+    return dict;
+}
 
-    const auto* vertices_ptr = static_cast<Vertex*>(vertices_buf.ptr);
-    const auto* indices_ptr = static_cast<Face*>(indices_buf.ptr);
-    const auto vertices = std::vector<Vertex>(vertices_ptr, vertices_ptr + vertices_buf.shape[0]);
-    const auto indices = std::vector<Face>(indices_ptr, indices_ptr + indices_buf.shape[0]);
+/*!
+ * @return The (uvs, texture_width, texture_height) tuple of an unwrapped mesh, followed by the statistics and charts dictionaries when requested
+ */
+static py::tuple resultTuple(UVsArray uvs, const UnwrapResult& result, bool return_stats, bool return_charts)
+{
+    const auto vertices_count = static_cast<size_t>(uvs.shape(0));
+    py::list output;
+    output.append(std::move(uvs));
+    output.append(result.texture_width);
+    output.append(result.texture_height);
+    if (return_stats)
+    {
+        output.append(statsDict(result.stats));
+    }
+    if (return_charts)
+    {
+        output.append(chartsDict(result, vertices_count));
+    }
+    return py::tuple(std::move(output));
+}
+
+py::tuple unwrap(const py::array& vertices, const py::array& indices, UnwrapOptions options, bool return_stats, bool return_charts)
+{
+    // The inputs are used in place when they already have the expected type and layout
+    const MeshInput input(vertices, indices);
+    const MeshView mesh = input.view();
 
-    // output shaping
-    const std::vector<py::ssize_t> shape = { static_cast<py::ssize_t>(vertices.size()), 2 };
-    const std::vector<py::ssize_t> strides = { static_cast<py::ssize_t>(sizeof(float) * shape[1]), static_cast<py::ssize_t>(sizeof(float)) };
-    std::vector<UVCoord> res(shape[0], { 0.0, 0.0 });
-    uint32_t texture_width;
-    uint32_t texture_height;
+    // The output is allocated up front, and the UV coordinates are written to it directly
+    UVsArray uvs({ static_cast<py::ssize_t>(mesh.vertices.size()), py::ssize_t(2) });
+    auto* uvs_data = reinterpret_cast<UVCoord*>(uvs.mutable_data());
+    options.track_memory = return_stats;
+    UnwrapResult result;
+    bool unwrapped;
 
     {
         py::gil_scoped_release release;
 
         // Do the actual calculation here
-        if (! smartUnwrap(vertices, indices, res, texture_width, texture_height))
+        unwrapped = smartUnwrap(mesh.vertices, mesh.faces, result, options);
+        if (unwrapped)
         {
-            throw std::runtime_error("Couldn't unwrap UV's!");
+            writeUVs(result, uvs_data, mesh.vertices.size());
         }
     }
 
+    if (! unwrapped)
+    {
+        throw std::runtime_error("Couldn't unwrap UV's!");
+    }
+
     // send output
-    return py::make_tuple(py::array(py::buffer_info(res.data(), strides[1], py::format_descriptor<float>::format(), shape.size(), shape, strides)), texture_width, texture_height);
+    return resultTuple(std::move(uvs), result, return_stats, return_charts);
+}
+
+py::list unwrapMany(const py::sequence& meshes, UnwrapOptions options, bool return_stats, bool return_charts)
+{
+    std::vector<MeshInput> inputs;
+    std::vector<MeshView> views;
+    std::vector<UVsArray> uvs;
+    inputs.reserve(meshes.size());
+    for (const py::handle mesh : meshes)
+    {
+        const auto mesh_tuple = mesh.cast<py::sequence>();
+        if (mesh_tuple.size() != 2)
+        {
+            throw py::value_error("meshes should be a list of (vertices, indices) tuples");
+        }
+        inputs.emplace_back(mesh_tuple[0].cast<py::array>(), mesh_tuple[1].cast<py::array>());
+        views.push_back(inputs.back().view());
+        uvs.emplace_back(std::vector<py::ssize_t>{ static_cast<py::ssize_t>(views.back().vertices.size()), py::ssize_t(2) });
+    }
+
+    std::vector<UVCoord*> uvs_data;
+    for (UVsArray& mesh_uvs : uvs)
+    {
+        uvs_data.push_back(reinterpret_cast<UVCoord*>(mesh_uvs.mutable_data()));
+    }
+
+    options.track_memory = return_stats;
+    std::vector<std::optional<UnwrapResult>> results;
+
+    {
+        py::gil_scoped_release release;
+
+        results = smartUnwrapMany(views, options);
+        for (size_t index = 0; index < results.size(); ++index)
+        {
+            if (results[index].has_value())
+            {
+                writeUVs(*results[index], uvs_data[index], views[index].vertices.size());
+            }
+        }
+    }
+
+    py::list output;
+    for (size_t index = 0; index < results.size(); ++index)
+    {
+        if (! results[index].has_value())
+        {
+            throw std::runtime_error("Couldn't unwrap UV's of mesh " + std::to_string(index) + "!");
+        }
+        output.append(resultTuple(std::move(uvs[index]), *results[index], return_stats, return_charts));
+    }
+    return output;
+}
+
+// Pool running the asynchronous unwrappings, started on first use, and stopped before the interpreter is finalized since the completions need it
+static UnwrapPool* async_pool = nullptr;
+
+static UnwrapPool& asyncPool()
+{
+    if (async_pool == nullptr)
+    {
+        async_pool = new UnwrapPool();
+        py::module_::import("atexit").attr("register")(py::cpp_function(
+            []()
+            {
+                // The pending unwrappings are cancelled, and their completions take the GIL to resolve their futures
+                std::unique_ptr<UnwrapPool> pool(std::exchange(async_pool, nullptr));
+                py::gil_scoped_release release;
+                pool.reset();
+            }));
+    }
+    return *async_pool;
+}
+
+py::object unwrapAsync(const py::array& vertices, const py::array& indices, UnwrapOptions options, bool return_stats, bool return_charts)
+{
+    // Python objects held by an unwrapping, which are released by its completion while holding the GIL
+    struct AsyncUnwrap
+    {
+        MeshInput input;
+        UVsArray uvs;
+        py::object future;
+        bool return_stats;
+        bool return_charts;
+    };
+
+    auto* async_unwrap = new AsyncUnwrap{ .input = MeshInput(vertices, indices),
+                                          .uvs = UVsArray(),
+                                          .future = py::module_::import("concurrent.futures").attr("Future")(),
+                                          .return_stats = return_stats,
+                                          .return_charts = return_charts };
+    const MeshView mesh = async_unwrap->input.view();
+    async_unwrap->uvs = UVsArray({ static_cast<py::ssize_t>(mesh.vertices.size()), py::ssize_t(2) });
+    auto* uvs_data = reinterpret_cast<UVCoord*>(async_unwrap->uvs.mutable_data());
+    py::object future = async_unwrap->future;
+    options.track_memory = return_stats;
+
+    std::stop_source stop_source = asyncPool().submit(
+        mesh,
+        std::move(options),
+        [async_unwrap, uvs_data, vertices_count = mesh.vertices.size()](std::optional<UnwrapResult> result)
+        {
+            if (result.has_value())
+            {
+                writeUVs(*result, uvs_data, vertices_count);
+            }
+
+            py::gil_scoped_acquire acquire;
+            const std::unique_ptr<AsyncUnwrap> owned_unwrap(async_unwrap);
+            const py::object& unwrap_future = owned_unwrap->future;
+            try
+            {
+                if (unwrap_future.attr("cancelled")().cast<bool>())
+                {
+                    return;
+                }
+                if (result.has_value())
+                {
+                    unwrap_future.attr("set_result")(resultTuple(std::move(owned_unwrap->uvs), *result, owned_unwrap->return_stats, owned_unwrap->return_charts));
+                }
+                else
+                {
+                    unwrap_future.attr("set_exception")(py::reinterpret_borrow<py::object>(PyExc_RuntimeError)("Couldn't unwrap UV's!"));
+                }
+            }
+            catch (py::error_already_set& error)
+            {
+                // The future may have been cancelled meanwhile by another thread
+                if (! unwrap_future.attr("cancelled")().cast<bool>())
+                {
+                    error.discard_as_unraisable("pyUvula.unwrap_async");
+                }
+            }
+        });
+
+    // Cancelling the future, directly or through the asyncio future wrapping it, cancels the unwrapping
+    future.attr("add_done_callback")(py::cpp_function(
+        [stop_source](const py::object& done_future) mutable
+        {
+            if (done_future.attr("cancelled")().cast<bool>())
+            {
+                stop_source.request_stop();
+            }
+        }));
+    return future;
 }
 
 PYBIND11_MODULE(pyUvula, module)
@@ -51,5 +452,75 @@ PYBIND11_MODULE(pyUvula, module)
     module.doc() = "UV-unwrapping library (or bindings to library), segmentation uses a classic normal-based grouping and charts packing uses xatlas";
     module.attr("__version__") = PYUVULA_VERSION;
 
-    module.def("unwrap", &unwrap, "Given the vertices, indices of a mesh, unwrap UV for texture-coordinates.");
+    const UnwrapOptions default_options;
+    py::class_<UnwrapOptions>(module, "UnwrapOptions", "Options of the segmentation and packing of the unwrapping")
+        .def(
+            py::init(
+                [](float angle_limit, uint32_t resolution, uint32_t padding, bool brute_force, uint32_t thread_count, uint32_t seed)
+                {
+                    return UnwrapOptions{ .thread_count = thread_count,
+                                          .angle_limit = angle_limit,
+                                          .resolution = resolution,
+                                          .padding = padding,
+                                          .brute_force = brute_force,
+                                          .seed = seed };
+                }),
+            py::kw_only(),
+            py::arg("angle_limit") = default_options.angle_limit,
+            py::arg("resolution") = default_options.resolution,
+            py::arg("padding") = default_options.padding,
+            py::arg("brute_force") = default_options.brute_force,
+            py::arg("thread_count") = default_options.thread_count,
+            py::arg("seed") = default_options.seed)
+        .def_readwrite("angle_limit", &UnwrapOptions::angle_limit, "Maximum angle, in degrees, between the normals of the faces projected together")
+        .def_readwrite("resolution", &UnwrapOptions::resolution, "Definition at which the charts are packed, before the texture is scaled up")
+        .def_readwrite("padding", &UnwrapOptions::padding, "Number of texels left between the charts, at the packing resolution")
+        .def_readwrite("brute_force", &UnwrapOptions::brute_force, "Try all the locations of each chart instead of random ones, which is much slower")
+        .def_readwrite("thread_count", &UnwrapOptions::thread_count, "Number of threads to be used, or 0 to use the CPUs available to the process")
+        .def_readwrite("seed", &UnwrapOptions::seed, "Seed of the random placement of the charts")
+        .def(
+            "__repr__",
+            [](const UnwrapOptions& options)
+            {
+                return "UnwrapOptions(angle_limit=" + std::to_string(options.angle_limit) + ", resolution=" + std::to_string(options.resolution)
+                     + ", padding=" + std::to_string(options.padding) + ", brute_force=" + (options.brute_force ? "True" : "False")
+                     + ", thread_count=" + std::to_string(options.thread_count) + ", seed=" + std::to_string(options.seed) + ")";
+            });
+
+    module.def(
+        "unwrap",
+        &unwrap,
+        "Given the vertices, indices of a mesh, unwrap UV for texture-coordinates. C-contiguous float32 vertices and uint32 indices are used without copy, "
+        "other floating-point and integer arrays are converted once. When return_stats is set, a dictionary of statistics of the unwrapping is returned "
+        "after the texture size. When return_charts is set, a dictionary of the charts is returned last: vertex_charts is the chart of each vertex, the faces "
+        "of chart i are faces[face_offsets[i]:face_offsets[i + 1]], rects are their (x, y, width, height) bounding rectangles in texels of the texture, "
+        "and rotated tells whether they were rotated by 90 degrees to be packed.",
+        py::arg("vertices"),
+        py::arg("indices"),
+        py::arg("options") = default_options,
+        py::arg("return_stats") = false,
+        py::arg("return_charts") = false);
+
+    module.def(
+        "unwrap_many",
+        &unwrapMany,
+        "Given a list of (vertices, indices) meshes, unwrap UV for texture-coordinates of all of them in parallel. Returns a list of (uvs, texture_width, "
+        "texture_height) tuples, in the same order as the meshes, followed by the dictionaries of statistics and charts when return_stats and return_charts "
+        "are set.",
+        py::arg("meshes"),
+        py::arg("options") = default_options,
+        py::arg("return_stats") = false,
+        py::arg("return_charts") = false);
+
+    module.def(
+        "unwrap_async",
+        &unwrapAsync,
+        "Same as unwrap, but runs in the background on a pool of threads shared by all the asynchronous unwrappings, and returns at once a "
+        "concurrent.futures.Future of the result. It can be awaited with asyncio.wrap_future(), and cancelling it cancels the unwrapping. The thread count "
+        "of the options is ignored.",
+        py::arg("vertices"),
+        py::arg("indices"),
+        py::arg("options") = default_options,
+        py::arg("return_stats") = false,
+        py::arg("return_charts") = false);
 }
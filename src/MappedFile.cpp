@@ -0,0 +1,110 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "MappedFile.h"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return;
+    }
+
+    struct stat status = {};
+    if (::fstat(descriptor, &status) == 0 && status.st_size > 0)
+    {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<char*>(mapping);
+            size_ = static_cast<size_t>(status.st_size);
+        }
+    }
+    ::close(descriptor);
+#else
+    std::ifstream file(path, std::ios::binary);
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path, size_t size)
+    : writable_(true)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+    {
+        return;
+    }
+
+    if (size > 0 && ::ftruncate(descriptor, static_cast<off_t>(size)) == 0)
+    {
+        void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<char*>(mapping);
+            size_ = size;
+        }
+    }
+    ::close(descriptor);
+#else
+    path_ = path;
+    buffer_.assign(size, '\0');
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (data_ != nullptr)
+    {
+        ::munmap(data_, size_);
+    }
+#else
+    if (writable_ && data_ != nullptr)
+    {
+        std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+        file.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+#endif
+}
+
+const char* MappedFile::data() const
+{
+    return data_;
+}
+
+char* MappedFile::mutableData()
+{
+    return writable_ ? data_ : nullptr;
+}
+
+size_t MappedFile::size() const
+{
+    return size_;
+}
+
+void MappedFile::adviseSequential() const
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (data_ != nullptr)
+    {
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+#endif
+}
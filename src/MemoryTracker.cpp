@@ -0,0 +1,104 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+// Allocations made through reallocate() are preceded by their size, so that they can be copied and released
+static constexpr size_t realloc_header_size = alignof(std::max_align_t);
+
+/*!
+ * Atomically raises a value to the given one, if it is greater
+ */
+static void updateMaximum(std::atomic<size_t>& maximum, size_t value)
+{
+    size_t previous = maximum.load(std::memory_order_relaxed);
+    while (previous < value && ! maximum.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+MemoryTracker::MemoryTracker(std::pmr::memory_resource* upstream)
+    : upstream_(upstream)
+{
+}
+
+void MemoryTracker::enterStage(UnwrapStage stage)
+{
+    const auto stage_index = static_cast<size_t>(stage);
+    current_stage_.store(stage_index, std::memory_order_relaxed);
+    updateMaximum(stage_peak_sizes_[stage_index], current_size_.load(std::memory_order_relaxed));
+}
+
+size_t MemoryTracker::currentSize() const
+{
+    return current_size_.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::peakSize() const
+{
+    return peak_size_.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::stagePeakSize(UnwrapStage stage) const
+{
+    return stage_peak_sizes_[static_cast<size_t>(stage)].load(std::memory_order_relaxed);
+}
+
+void* MemoryTracker::reallocate(void* user_data, void* ptr, size_t size)
+{
+    auto* tracker = static_cast<MemoryTracker*>(user_data);
+
+    auto* header = static_cast<unsigned char*>(tracker->allocate(realloc_header_size + size, alignof(std::max_align_t)));
+    std::memcpy(header, &size, sizeof(size_t));
+    unsigned char* new_ptr = header + realloc_header_size;
+    if (ptr != nullptr)
+    {
+        size_t previous_size;
+        std::memcpy(&previous_size, static_cast<unsigned char*>(ptr) - realloc_header_size, sizeof(size_t));
+        std::memcpy(new_ptr, ptr, std::min(previous_size, size));
+        release(user_data, ptr);
+    }
+    return new_ptr;
+}
+
+void MemoryTracker::release(void* user_data, void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    auto* tracker = static_cast<MemoryTracker*>(user_data);
+    unsigned char* header = static_cast<unsigned char*>(ptr) - realloc_header_size;
+    size_t size;
+    std::memcpy(&size, header, sizeof(size_t));
+    tracker->deallocate(header, realloc_header_size + size, alignof(std::max_align_t));
+}
+
+void* MemoryTracker::do_allocate(size_t bytes, size_t alignment)
+{
+    void* ptr = upstream_->allocate(bytes, alignment);
+    addUsage(bytes);
+    return ptr;
+}
+
+void MemoryTracker::do_deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    upstream_->deallocate(ptr, bytes, alignment);
+    current_size_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool MemoryTracker::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void MemoryTracker::addUsage(size_t bytes)
+{
+    const size_t current_size = current_size_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updateMaximum(peak_size_, current_size);
+    updateMaximum(stage_peak_sizes_[current_stage_.load(std::memory_order_relaxed)], current_size);
+}
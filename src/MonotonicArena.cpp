@@ -0,0 +1,111 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "MonotonicArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+// Allocations made through reallocate() are preceded by their size, so that they can be copied when growing
+static constexpr size_t realloc_header_size = alignof(std::max_align_t);
+
+MonotonicArena::MonotonicArena(size_t block_size, std::pmr::memory_resource* upstream)
+    : upstream_(upstream)
+    , block_size_(std::max(block_size, realloc_header_size))
+{
+    current_block_ = reserveBlock(block_size_, nullptr);
+}
+
+MonotonicArena::~MonotonicArena()
+{
+    Block* block = current_block_.load();
+    while (block != nullptr)
+    {
+        Block* next = block->next;
+        const size_t size = block->size;
+        block->~Block();
+        upstream_->deallocate(block, sizeof(Block) + size, alignof(std::max_align_t));
+        block = next;
+    }
+}
+
+size_t MonotonicArena::usedSize() const
+{
+    return used_size_.load(std::memory_order_relaxed);
+}
+
+size_t MonotonicArena::reservedSize() const
+{
+    return reserved_size_.load(std::memory_order_relaxed);
+}
+
+void* MonotonicArena::reallocate(void* user_data, void* ptr, size_t size)
+{
+    auto* arena = static_cast<MonotonicArena*>(user_data);
+
+    size_t previous_size = 0;
+    if (ptr != nullptr)
+    {
+        std::memcpy(&previous_size, static_cast<unsigned char*>(ptr) - realloc_header_size, sizeof(size_t));
+        if (size <= previous_size)
+        {
+            return ptr;
+        }
+    }
+
+    auto* header = static_cast<unsigned char*>(arena->allocate(realloc_header_size + size, alignof(std::max_align_t)));
+    std::memcpy(header, &size, sizeof(size_t));
+    unsigned char* new_ptr = header + realloc_header_size;
+    if (ptr != nullptr)
+    {
+        std::memcpy(new_ptr, ptr, previous_size);
+    }
+    return new_ptr;
+}
+
+void MonotonicArena::release(void* /*user_data*/, void* /*ptr*/)
+{
+}
+
+void* MonotonicArena::do_allocate(size_t bytes, size_t alignment)
+{
+    // Reserve enough space to be able to align the returned address
+    const size_t padded_size = bytes + alignment - 1;
+
+    while (true)
+    {
+        Block* block = current_block_.load(std::memory_order_acquire);
+        const size_t offset = block->used.fetch_add(padded_size, std::memory_order_relaxed);
+        if (offset + padded_size <= block->size) [[likely]]
+        {
+            used_size_.fetch_add(padded_size, std::memory_order_relaxed);
+            const auto address = reinterpret_cast<uintptr_t>(block->data() + offset);
+            return reinterpret_cast<void*>((address + alignment - 1) & ~(alignment - 1));
+        }
+
+        // The block is exhausted, reserve a new one unless another thread already did
+        std::lock_guard lock(reserve_mutex_);
+        if (current_block_.load(std::memory_order_relaxed) == block)
+        {
+            current_block_.store(reserveBlock(std::max(block_size_, padded_size), block), std::memory_order_release);
+        }
+    }
+}
+
+void MonotonicArena::do_deallocate(void* /*ptr*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+    // Memory is only released when the arena is destroyed
+}
+
+bool MonotonicArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+MonotonicArena::Block* MonotonicArena::reserveBlock(size_t size, Block* next)
+{
+    void* memory = upstream_->allocate(sizeof(Block) + size, alignof(std::max_align_t));
+    reserved_size_.fetch_add(size, std::memory_order_relaxed);
+    return new (memory) Block{ .next = next, .size = size, .used = 0 };
+}
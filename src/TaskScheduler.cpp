@@ -0,0 +1,625 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "TaskScheduler.h"
+
+#include <cmath>
+#include <fstream>
+#include <semaphore>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "TaskExecutor.h"
+#include "trace.h"
+
+
+// Scheduler whose worker is the current thread, and index of this worker
+static thread_local const TaskScheduler* s_current_scheduler = nullptr;
+static thread_local uint32_t s_current_thread_index = 0;
+
+// Number of attempts to find a task before an idle worker goes to sleep
+static constexpr uint32_t spin_count = 64;
+
+// Avoid false sharing between the ends of a deque, which are accessed by different threads
+static constexpr size_t cache_line_size = 64;
+
+/*!
+ * Chase-Lev deque: the owner thread pushes and pops tasks at the bottom, while the other threads steal tasks at the top. The buffer grows when full, and
+ * the previous buffers are kept until destruction because thieves may still be reading them.
+ */
+class TaskScheduler::TaskDeque
+{
+public:
+    TaskDeque()
+    {
+        buffers_.push_back(std::make_unique<Buffer>(initial_capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    /*! Pushes a task at the bottom, may only be called by the owner thread */
+    void push(Task* task)
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_acquire);
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+        if (bottom - top >= buffer->capacity) [[unlikely]]
+        {
+            buffer = grow(buffer, top, bottom);
+        }
+        buffer->put(bottom, task);
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    /*! Pops the last pushed task, may only be called by the owner thread */
+    Task* pop()
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            // Empty deque
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = buffer->get(bottom);
+        if (top == bottom)
+        {
+            // Last task, race against the thieves
+            if (! top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                task = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    /*! Steals the first pushed task, may be called by any thread */
+    Task* steal()
+    {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        Task* task = buffer_.load(std::memory_order_acquire)->get(top);
+        if (! top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            // Lost the race against another thief or the owner
+            return nullptr;
+        }
+        return task;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return top_.load(std::memory_order_seq_cst) >= bottom_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    static constexpr int64_t initial_capacity = 256;
+
+    struct Buffer
+    {
+        explicit Buffer(int64_t buffer_capacity)
+            : capacity(buffer_capacity)
+            , tasks(std::make_unique<std::atomic<Task*>[]>(buffer_capacity))
+        {
+        }
+
+        [[nodiscard]] Task* get(int64_t index) const
+        {
+            return tasks[index & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, Task* task)
+        {
+            tasks[index & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+
+        const int64_t capacity; // Always a power of 2
+        std::unique_ptr<std::atomic<Task*>[]> tasks;
+    };
+
+    Buffer* grow(Buffer* buffer, int64_t top, int64_t bottom)
+    {
+        buffers_.push_back(std::make_unique<Buffer>(buffer->capacity * 2));
+        Buffer* new_buffer = buffers_.back().get();
+        for (int64_t index = top; index < bottom; ++index)
+        {
+            new_buffer->put(index, buffer->get(index));
+        }
+        buffer_.store(new_buffer, std::memory_order_release);
+        return new_buffer;
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<int64_t> top_{ 0 };
+    alignas(cache_line_size) std::atomic<int64_t> bottom_{ 0 };
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_; // Only accessed by the owner thread
+};
+
+// Statistics of one thread, padded so that the counters of different threads don't share cache lines
+struct alignas(cache_line_size) TaskScheduler::ThreadCounters
+{
+    std::atomic<uint64_t> executed_tasks{ 0 };
+    std::atomic<uint64_t> stolen_tasks{ 0 };
+    std::atomic<int32_t> cpu{ -1 };
+};
+
+struct TaskScheduler::Worker
+{
+    std::thread thread;
+    std::counting_semaphore<> wakeup{ 0 }; // Not a binary semaphore, because the shutdown may add a token to a worker that already has one
+    bool idle{ false }; // Protected by the idle workers mutex
+};
+
+/*!
+ * @return The list of CPUs the process is allowed to run on, which is empty if it can not be retrieved
+ */
+static std::vector<int32_t> allowedCpus()
+{
+    std::vector<int32_t> cpus;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    {
+        for (int32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &cpu_set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+/*!
+ * State shared by a scheduler and the jobs it submitted to its executor. It is released by the last of them, so that jobs still queued in the executor when
+ * the scheduler is destroyed can find out that it is gone when they start, instead of the scheduler waiting for them.
+ */
+struct TaskScheduler::ExecutorState
+{
+    TaskScheduler* scheduler{ nullptr }; // Only valid while shutdown is not set, or for the running jobs
+    std::atomic<uint32_t> references{ 1 }; // The scheduler and each submitted job
+    std::atomic<uint32_t> jobs_count{ 0 }; // Jobs submitted and not finished, whether they started or not
+    std::atomic<uint32_t> running_jobs_count{ 0 };
+    std::atomic<bool> shutdown{ false };
+
+    void release()
+    {
+        if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+};
+
+TaskScheduler::TaskScheduler(uint32_t thread_count, bool pin_workers)
+{
+    thread_count = std::max(thread_count, 1U);
+    for (uint32_t index = 0; index < thread_count; ++index)
+    {
+        deques_.push_back(std::make_unique<TaskDeque>());
+    }
+    counters_ = std::make_unique<ThreadCounters[]>(thread_count);
+
+    // The creating thread is not pinned, it belongs to the caller. Workers are spread over the allowed CPUs in order, which keeps consecutive workers on
+    // the same NUMA node.
+    const std::vector<int32_t> cpus = pin_workers ? allowedCpus() : std::vector<int32_t>();
+
+    idle_workers_.reserve(thread_count - 1);
+    for (uint32_t index = 1; index < thread_count; ++index)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (uint32_t index = 1; index < thread_count; ++index)
+    {
+        const int32_t cpu = cpus.empty() ? -1 : cpus[(index - 1) % cpus.size()];
+        workers_[index - 1]->thread = std::thread(&TaskScheduler::workerThread, this, index, cpu);
+    }
+}
+
+TaskScheduler::TaskScheduler(TaskExecutor& executor, uint32_t thread_count)
+    : executor_(&executor)
+{
+    thread_count = thread_count > 0 ? thread_count : executor.concurrency() + 1;
+    thread_count = std::max(thread_count, 1U);
+    for (uint32_t index = 0; index < thread_count; ++index)
+    {
+        deques_.push_back(std::make_unique<TaskDeque>());
+    }
+
+    counters_ = std::make_unique<ThreadCounters[]>(thread_count);
+    executor_slots_used_ = std::make_unique<std::atomic<bool>[]>(thread_count);
+    executor_state_ = new ExecutorState{ .scheduler = this };
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    shutdown_.store(true, std::memory_order_seq_cst);
+    for (const std::unique_ptr<Worker>& worker : workers_)
+    {
+        worker->wakeup.release();
+    }
+    for (const std::unique_ptr<Worker>& worker : workers_)
+    {
+        worker->thread.join();
+    }
+
+    // Running executor jobs reference the scheduler until they are done. Queued ones may never start while the threads of the executor are busy, e.g. when
+    // the scheduler is used from one of them, so they are not waited for: they see the shutdown when they start, and return at once. Pairs with the
+    // sequentially consistent increment of the running jobs.
+    if (executor_state_ != nullptr)
+    {
+        executor_state_->shutdown.store(true, std::memory_order_seq_cst);
+        while (executor_state_->running_jobs_count.load(std::memory_order_seq_cst) > 0)
+        {
+            std::this_thread::yield();
+        }
+        executor_state_->release();
+    }
+}
+
+uint32_t TaskScheduler::threadCount() const
+{
+    return static_cast<uint32_t>(deques_.size());
+}
+
+std::vector<WorkerStats> TaskScheduler::workerStats() const
+{
+    std::vector<WorkerStats> stats(threadCount());
+    for (size_t index = 0; index < stats.size(); ++index)
+    {
+        stats[index].executed_tasks = counters_[index].executed_tasks.load(std::memory_order_relaxed);
+        stats[index].stolen_tasks = counters_[index].stolen_tasks.load(std::memory_order_relaxed);
+        stats[index].cpu = counters_[index].cpu.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+uint32_t TaskScheduler::currentThreadIndex()
+{
+    return s_current_thread_index;
+}
+
+/*!
+ * Reads the CPU quota of the cgroup of the process
+ * @return The number of CPUs the quota corresponds to, rounded up, or 0 if there is no quota
+ */
+static uint32_t cgroupCpuQuota()
+{
+    double quota = -1.0;
+    double period = 0.0;
+
+    // cgroup v2 contains "<quota> <period>", with a quota of "max" if unlimited
+    std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+    std::string quota_value;
+    if (cpu_max >> quota_value >> period)
+    {
+        if (quota_value != "max")
+        {
+            quota = std::stod(quota_value);
+        }
+    }
+    else
+    {
+        // cgroup v1 has the quota and period in separate files, with a quota of -1 if unlimited
+        std::ifstream cfs_quota("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream cfs_period("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (! (cfs_quota >> quota && cfs_period >> period))
+        {
+            quota = -1.0;
+        }
+    }
+
+    if (quota <= 0.0 || period <= 0.0)
+    {
+        return 0;
+    }
+    return std::max(static_cast<uint32_t>(std::ceil(quota / period)), 1U);
+}
+
+uint32_t TaskScheduler::defaultThreadCount()
+{
+    static const uint32_t thread_count = []()
+    {
+        uint32_t count = std::max(std::thread::hardware_concurrency(), 1U);
+
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+        {
+            count = std::min(count, static_cast<uint32_t>(std::max(CPU_COUNT(&cpu_set), 1)));
+        }
+
+        if (const uint32_t quota = cgroupCpuQuota(); quota > 0)
+        {
+            count = std::min(count, quota);
+        }
+#endif
+
+        return count;
+    }();
+
+    return thread_count;
+}
+
+void TaskScheduler::run(TaskGroup& group, Task& task)
+{
+    task.group = &group;
+    group.pending_tasks.fetch_add(1, std::memory_order_relaxed);
+    deques_[ownDequeIndex()]->push(&task);
+
+    if (executor_ != nullptr)
+    {
+        submitExecutorJob();
+        return;
+    }
+
+    // Pairs with the fence of the worker going to sleep, so that either it sees the new task or we see it idle
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_workers_count_.load(std::memory_order_relaxed) > 0)
+    {
+        wakeWorker();
+    }
+}
+
+void TaskScheduler::wait(TaskGroup& group)
+{
+    const uint32_t thread_index = ownDequeIndex();
+    uint32_t steal_seed = (thread_index + 1) * 2654435761U;
+    while (group.pending_tasks.load(std::memory_order_acquire) > 0)
+    {
+        if (Task* task = findTask(thread_index, steal_seed))
+        {
+            execute(task);
+        }
+        else
+        {
+            // The remaining tasks are being run by other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint32_t TaskScheduler::ownDequeIndex() const
+{
+    return s_current_scheduler == this ? s_current_thread_index : 0;
+}
+
+TaskScheduler::Task* TaskScheduler::findTask(uint32_t thread_index, uint32_t& steal_seed)
+{
+    ThreadCounters& counters = counters_[thread_index];
+    if (Task* task = deques_[thread_index]->pop())
+    {
+        counters.executed_tasks.fetch_add(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    // Start stealing from a pseudo-random deque, so that thieves don't all compete for the same one
+    const auto deques_count = static_cast<uint32_t>(deques_.size());
+    steal_seed ^= steal_seed << 13;
+    steal_seed ^= steal_seed >> 17;
+    steal_seed ^= steal_seed << 5;
+    for (uint32_t offset = 0; offset < deques_count; ++offset)
+    {
+        const uint32_t victim = (steal_seed + offset) % deques_count;
+        if (victim == thread_index)
+        {
+            continue;
+        }
+
+        if (Task* task = deques_[victim]->steal())
+        {
+            counters.executed_tasks.fetch_add(1, std::memory_order_relaxed);
+            counters.stolen_tasks.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+TaskScheduler::Task* TaskScheduler::spinForTask(uint32_t thread_index, uint32_t& steal_seed)
+{
+    for (uint32_t attempt = 0; attempt < spin_count; ++attempt)
+    {
+        if (Task* task = findTask(thread_index, steal_seed))
+        {
+            return task;
+        }
+        std::this_thread::yield();
+    }
+    return nullptr;
+}
+
+bool TaskScheduler::hasTasks() const
+{
+    return std::any_of(
+        deques_.begin(),
+        deques_.end(),
+        [](const std::unique_ptr<TaskDeque>& deque)
+        {
+            return ! deque->empty();
+        });
+}
+
+void TaskScheduler::execute(Task* task)
+{
+    UVULA_TRACE_ZONE("task");
+    TaskGroup* group = task->group;
+    task->function(task->user_data);
+    group->pending_tasks.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskScheduler::wakeWorker()
+{
+    Worker* worker = nullptr;
+    {
+        std::lock_guard lock(idle_mutex_);
+        if (idle_workers_.empty())
+        {
+            return;
+        }
+        worker = idle_workers_.back();
+        idle_workers_.pop_back();
+        worker->idle = false;
+        idle_workers_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    worker->wakeup.release();
+}
+
+void TaskScheduler::workerThread(uint32_t thread_index, int32_t cpu)
+{
+    s_current_scheduler = this;
+    s_current_thread_index = thread_index;
+#ifdef __linux__
+    if (cpu >= 0)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0)
+        {
+            counters_[thread_index].cpu.store(cpu, std::memory_order_relaxed);
+        }
+    }
+#endif
+    Worker& worker = *workers_[thread_index - 1];
+    uint32_t steal_seed = (thread_index + 1) * 2654435761U;
+
+    while (! shutdown_.load(std::memory_order_relaxed))
+    {
+        if (Task* task = spinForTask(thread_index, steal_seed))
+        {
+            execute(task);
+            continue;
+        }
+
+        // Register as idle, then check again for tasks that may have been scheduled meanwhile before going to sleep
+        {
+            std::lock_guard lock(idle_mutex_);
+            worker.idle = true;
+            idle_workers_.push_back(&worker);
+            idle_workers_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (hasTasks() || shutdown_.load(std::memory_order_relaxed))
+        {
+            std::unique_lock lock(idle_mutex_);
+            if (worker.idle)
+            {
+                worker.idle = false;
+                idle_workers_.erase(std::find(idle_workers_.begin(), idle_workers_.end(), &worker));
+                idle_workers_count_.fetch_sub(1, std::memory_order_relaxed);
+                continue;
+            }
+        }
+
+        // Either no task was found, or another thread already chose to wake us up
+        worker.wakeup.acquire();
+    }
+}
+
+void TaskScheduler::submitExecutorJob()
+{
+    // Start a new job unless all the worker slots are already used, the running jobs will then steal the task
+    const auto max_jobs_count = static_cast<uint32_t>(deques_.size() - 1);
+    uint32_t jobs_count = executor_state_->jobs_count.load(std::memory_order_relaxed);
+    while (jobs_count < max_jobs_count)
+    {
+        if (executor_state_->jobs_count.compare_exchange_weak(jobs_count, jobs_count + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            executor_state_->references.fetch_add(1, std::memory_order_relaxed);
+            executor_->execute(&TaskScheduler::executorJob, executor_state_);
+            return;
+        }
+    }
+}
+
+void TaskScheduler::executorJob(void* user_data)
+{
+    auto* state = static_cast<ExecutorState*>(user_data);
+    state->running_jobs_count.fetch_add(1, std::memory_order_seq_cst);
+    if (! state->shutdown.load(std::memory_order_seq_cst))
+    {
+        state->scheduler->runExecutorJob();
+    }
+
+    state->jobs_count.fetch_sub(1, std::memory_order_release);
+    // Last access to the scheduler, which may be destroyed right after
+    state->running_jobs_count.fetch_sub(1, std::memory_order_release);
+    state->release();
+}
+
+void TaskScheduler::runExecutorJob()
+{
+    // The executor thread may be used for other work, so restore its state when done
+    const TaskScheduler* previous_scheduler = s_current_scheduler;
+    const uint32_t previous_thread_index = s_current_thread_index;
+
+    uint32_t thread_index = claimExecutorSlot();
+    uint32_t steal_seed = (thread_index + 1) * 2654435761U;
+    s_current_scheduler = this;
+    s_current_thread_index = thread_index;
+
+    while (true)
+    {
+        if (Task* task = spinForTask(thread_index, steal_seed))
+        {
+            execute(task);
+            continue;
+        }
+
+        // Release the slot, then check again for tasks that may have been scheduled while all the slots were used
+        executor_slots_used_[thread_index].store(false, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shutdown_.load(std::memory_order_relaxed) || ! hasTasks())
+        {
+            break;
+        }
+
+        thread_index = claimExecutorSlot();
+        s_current_thread_index = thread_index;
+    }
+
+    s_current_scheduler = previous_scheduler;
+    s_current_thread_index = previous_thread_index;
+}
+
+uint32_t TaskScheduler::claimExecutorSlot()
+{
+    // There are never more jobs than slots, but a finishing job may not have released its slot yet
+    while (true)
+    {
+        for (uint32_t index = 1; index < deques_.size(); ++index)
+        {
+            bool expected = false;
+            if (! executor_slots_used_[index].load(std::memory_order_relaxed)
+                && executor_slots_used_[index].compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                return index;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,291 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "UnwrapCache.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "Face.h"
+#include "MappedFile.h"
+#include "PackedChart.h"
+#include "UVCoord.h"
+#include "UnwrapResult.h"
+#include "Vertex.h"
+#include "hash_utils.h"
+#include "unwrap.h"
+
+// Version of the format of the cache files, to be increased when it changes so that the previous files are ignored
+static constexpr uint32_t cache_format_version = 2;
+static constexpr uint32_t cache_magic = 0x31435655; // "UVC1"
+static constexpr std::string_view cache_extension = ".uvc";
+
+/*!
+ * Header of a cache file, followed by the UV coordinates, the faces, the vertices cross-references, the vertices charts, the charts and the charts faces of
+ * the result
+ */
+struct CacheFileHeader
+{
+    uint32_t magic{ cache_magic };
+    uint32_t format_version{ cache_format_version };
+    uint64_t key{ 0 };
+    uint64_t uv_hash{ 0 };
+    uint64_t uv_coords_count{ 0 };
+    uint64_t faces_count{ 0 };
+    uint64_t chart_faces_count{ 0 };
+    uint32_t texture_width{ 0 };
+    uint32_t texture_height{ 0 };
+    uint32_t charts_count{ 0 };
+    float utilization{ 0.0F };
+};
+
+UnwrapCache::UnwrapCache(std::filesystem::path directory, uintmax_t max_size)
+    : directory_(std::move(directory))
+    , max_size_(max_size)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error)
+    {
+        spdlog::warn("Unable to create the cache directory {}: {}", directory_.string(), error.message());
+    }
+}
+
+bool UnwrapCache::smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options)
+{
+    // The atlas image is not stored, so a result requiring it is always calculated
+    const uint64_t result_key = key(vertices, faces, options);
+    if (! options.create_image && load(result_key, result))
+    {
+        return true;
+    }
+
+    if (! ::smartUnwrap(vertices, faces, result, options))
+    {
+        return false;
+    }
+
+    store(result_key, result);
+    return true;
+}
+
+uint64_t UnwrapCache::key(std::span<const Vertex> vertices, std::span<const Face> faces, const UnwrapOptions& options)
+{
+    // Only the segmentation and packing options change the result, the other options change how it is calculated. The library version is part of the
+    // key, so that results of another version are never loaded.
+    constexpr std::string_view version = UVULA_VERSION;
+    uint64_t hash = hash_utils::hashBytes(version.data(), version.size(), cache_format_version);
+    hash = hash_utils::hashBytes(&options.angle_limit, sizeof(options.angle_limit), hash);
+    hash = hash_utils::hashBytes(&options.resolution, sizeof(options.resolution), hash);
+    hash = hash_utils::hashBytes(&options.padding, sizeof(options.padding), hash);
+    hash = hash_utils::hashBytes(&options.brute_force, sizeof(options.brute_force), hash);
+    hash = hash_utils::hashBytes(&options.seed, sizeof(options.seed), hash);
+    hash = hash_utils::hashBytes(faces.data(), faces.size() * sizeof(Face), hash);
+    return hash_utils::hashBytes(vertices.data(), vertices.size() * sizeof(Vertex), hash);
+}
+
+bool UnwrapCache::load(uint64_t key, UnwrapResult& result)
+{
+    const std::filesystem::path path = entryPath(key);
+    {
+        const MappedFile file(path);
+        CacheFileHeader header;
+        if (file.size() < sizeof(header))
+        {
+            ++misses_;
+            return false;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        const size_t uv_coords_size = header.uv_coords_count * sizeof(UVCoord);
+        const size_t faces_size = header.faces_count * sizeof(Face);
+        const size_t vertex_xref_size = header.uv_coords_count * sizeof(uint32_t);
+        const size_t vertex_chart_size = header.uv_coords_count * sizeof(int32_t);
+        const size_t charts_size = header.charts_count * sizeof(PackedChart);
+        const size_t chart_faces_size = header.chart_faces_count * sizeof(uint32_t);
+        if (header.magic != cache_magic || header.format_version != cache_format_version || header.key != key
+            || file.size() != sizeof(header) + uv_coords_size + faces_size + vertex_xref_size + vertex_chart_size + charts_size + chart_faces_size)
+        {
+            spdlog::warn("Ignoring invalid cache file {}", path.string());
+            ++misses_;
+            return false;
+        }
+
+        const char* data = file.data() + sizeof(header);
+        result = UnwrapResult{};
+        result.uv_coords.resize(header.uv_coords_count);
+        std::memcpy(result.uv_coords.data(), data, uv_coords_size);
+        data += uv_coords_size;
+        result.faces.resize(header.faces_count);
+        std::memcpy(result.faces.data(), data, faces_size);
+        data += faces_size;
+        result.vertex_xref.resize(header.uv_coords_count);
+        std::memcpy(result.vertex_xref.data(), data, vertex_xref_size);
+        data += vertex_xref_size;
+        result.vertex_chart.resize(header.uv_coords_count);
+        std::memcpy(result.vertex_chart.data(), data, vertex_chart_size);
+        data += vertex_chart_size;
+        result.charts.resize(header.charts_count);
+        std::memcpy(result.charts.data(), data, charts_size);
+        data += charts_size;
+        result.chart_faces.resize(header.chart_faces_count);
+        std::memcpy(result.chart_faces.data(), data, chart_faces_size);
+        result.texture_width = header.texture_width;
+        result.texture_height = header.texture_height;
+        result.uv_hash = header.uv_hash;
+        result.stats.from_cache = true;
+        result.stats.charts_count = header.charts_count;
+        result.stats.utilization = header.utilization;
+    }
+
+    if (calculateUvHash(result) != result.uv_hash)
+    {
+        spdlog::warn("Ignoring corrupted cache file {}", path.string());
+        result = UnwrapResult{};
+        ++misses_;
+        return false;
+    }
+
+    // Mark the result as recently used
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    ++hits_;
+    return true;
+}
+
+bool UnwrapCache::store(uint64_t key, const UnwrapResult& result)
+{
+    CacheFileHeader header;
+    header.key = key;
+    header.uv_hash = result.uv_hash;
+    header.uv_coords_count = result.uv_coords.size();
+    header.faces_count = result.faces.size();
+    header.chart_faces_count = result.chart_faces.size();
+    header.texture_width = result.texture_width;
+    header.texture_height = result.texture_height;
+    header.charts_count = static_cast<uint32_t>(result.charts.size());
+    header.utilization = result.stats.utilization;
+
+    // Write a temporary file, then rename it, so that a partially written file is never loaded
+    const std::filesystem::path path = entryPath(key);
+    std::filesystem::path temporary_path = path;
+    const auto unique_id = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    temporary_path += "." + std::to_string(unique_id) + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(result.uv_coords.data()), static_cast<std::streamsize>(result.uv_coords.size() * sizeof(UVCoord)));
+        file.write(reinterpret_cast<const char*>(result.faces.data()), static_cast<std::streamsize>(result.faces.size() * sizeof(Face)));
+        file.write(reinterpret_cast<const char*>(result.vertex_xref.data()), static_cast<std::streamsize>(result.vertex_xref.size() * sizeof(uint32_t)));
+        file.write(reinterpret_cast<const char*>(result.vertex_chart.data()), static_cast<std::streamsize>(result.vertex_chart.size() * sizeof(int32_t)));
+        file.write(reinterpret_cast<const char*>(result.charts.data()), static_cast<std::streamsize>(result.charts.size() * sizeof(PackedChart)));
+        file.write(reinterpret_cast<const char*>(result.chart_faces.data()), static_cast<std::streamsize>(result.chart_faces.size() * sizeof(uint32_t)));
+        if (! file)
+        {
+            spdlog::warn("Unable to write the cache file {}", temporary_path.string());
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        spdlog::warn("Unable to write the cache file {}: {}", path.string(), error.message());
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+const std::filesystem::path& UnwrapCache::directory() const
+{
+    return directory_;
+}
+
+uint64_t UnwrapCache::hits() const
+{
+    return hits_;
+}
+
+uint64_t UnwrapCache::misses() const
+{
+    return misses_;
+}
+
+std::filesystem::path UnwrapCache::entryPath(uint64_t key) const
+{
+    std::array<char, 17> name{};
+    constexpr std::string_view digits = "0123456789abcdef";
+    for (size_t index = 0; index < 16; ++index)
+    {
+        name[15 - index] = digits[(key >> (index * 4)) & 0xF];
+    }
+    return directory_ / (std::string(name.data()) + std::string(cache_extension));
+}
+
+void UnwrapCache::evict()
+{
+    struct Entry
+    {
+        std::filesystem::path path;
+        uintmax_t size;
+        std::filesystem::file_time_type last_use;
+    };
+
+    std::vector<Entry> entries;
+    uintmax_t total_size = 0;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& directory_entry : std::filesystem::directory_iterator(directory_, error))
+    {
+        if (directory_entry.path().extension() != cache_extension)
+        {
+            continue;
+        }
+
+        Entry entry{ .path = directory_entry.path(), .size = directory_entry.file_size(error), .last_use = directory_entry.last_write_time(error) };
+        if (! error)
+        {
+            total_size += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    if (total_size <= max_size_)
+    {
+        return;
+    }
+
+    // Remove the least recently used results first. Files being read by other processes remain valid until they are closed.
+    std::sort(
+        entries.begin(),
+        entries.end(),
+        [](const Entry& lhs, const Entry& rhs)
+        {
+            return lhs.last_use < rhs.last_use;
+        });
+    for (const Entry& entry : entries)
+    {
+        if (total_size <= max_size_)
+        {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, error))
+        {
+            total_size -= entry.size;
+        }
+    }
+}
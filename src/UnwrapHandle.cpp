@@ -0,0 +1,64 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "UnwrapHandle.h"
+
+#include <chrono>
+
+UnwrapHandle::UnwrapHandle(std::future<std::optional<UnwrapResult>> result, std::stop_source stop_source)
+    : result_(std::move(result))
+    , stop_source_(std::move(stop_source))
+{
+}
+
+UnwrapHandle& UnwrapHandle::operator=(UnwrapHandle&& other) noexcept
+{
+    if (this != &other)
+    {
+        stop();
+        result_ = std::move(other.result_);
+        stop_source_ = std::move(other.stop_source_);
+    }
+    return *this;
+}
+
+UnwrapHandle::~UnwrapHandle()
+{
+    stop();
+}
+
+void UnwrapHandle::cancel()
+{
+    stop_source_.request_stop();
+}
+
+bool UnwrapHandle::cancelled() const
+{
+    return stop_source_.stop_requested();
+}
+
+bool UnwrapHandle::ready() const
+{
+    return ! result_.valid() || result_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void UnwrapHandle::wait() const
+{
+    if (result_.valid())
+    {
+        result_.wait();
+    }
+}
+
+std::optional<UnwrapResult> UnwrapHandle::get()
+{
+    return result_.get();
+}
+
+void UnwrapHandle::stop()
+{
+    if (result_.valid())
+    {
+        cancel();
+        result_.wait();
+    }
+}
@@ -0,0 +1,160 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "UnwrapPool.h"
+
+#include <atomic>
+#include <future>
+#include <utility>
+
+#include "trace.h"
+#include "unwrap_stages.h"
+
+struct UnwrapPool::Job
+{
+    MeshView mesh;
+    UnwrapOptions options;
+    Completion completion;
+    TaskScheduler* scheduler{ nullptr };
+    std::stop_source stop_source; // Checked by the unwrapping, instead of the stop token given in the options
+    std::optional<std::stop_callback<std::function<void()>>> forward_stop; // Forwards the stop requests of the given stop token
+    TaskScheduler::Task task;
+    TaskScheduler::TaskGroup group;
+};
+
+UnwrapPool::UnwrapPool(uint32_t thread_count)
+    : scheduler_((thread_count > 0 ? thread_count : TaskScheduler::defaultThreadCount()) + 1)
+    , dispatch_thread_(&UnwrapPool::dispatchThread, this)
+{
+}
+
+UnwrapPool::~UnwrapPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        shutdown_ = true;
+        for (const std::unique_ptr<Job>& job : pending_jobs_)
+        {
+            job->stop_source.request_stop();
+        }
+    }
+    condition_.notify_one();
+    dispatch_thread_.join();
+}
+
+std::stop_source UnwrapPool::submit(MeshView mesh, UnwrapOptions options, Completion completion)
+{
+    auto job = std::make_unique<Job>();
+    job->mesh = mesh;
+    job->completion = std::move(completion);
+    job->scheduler = &scheduler_;
+    job->forward_stop.emplace(
+        options.stop_token,
+        [stop_source = job->stop_source]() mutable
+        {
+            stop_source.request_stop();
+        });
+    options.stop_token = job->stop_source.get_token();
+    job->options = std::move(options);
+    std::stop_source stop_source = job->stop_source;
+
+    {
+        std::lock_guard lock(mutex_);
+        pending_jobs_.push_back(std::move(job));
+    }
+    condition_.notify_one();
+    return stop_source;
+}
+
+UnwrapHandle UnwrapPool::submit(std::vector<Vertex> vertices, std::vector<Face> faces, UnwrapOptions options)
+{
+    // The mesh is owned by the completion, so that it is released as soon as the unwrapping is done
+    struct OwnedMesh
+    {
+        std::vector<Vertex> vertices;
+        std::vector<Face> faces;
+        std::promise<std::optional<UnwrapResult>> promise;
+    };
+
+    auto owned_mesh = std::make_shared<OwnedMesh>(OwnedMesh{ .vertices = std::move(vertices), .faces = std::move(faces) });
+    std::future<std::optional<UnwrapResult>> result = owned_mesh->promise.get_future();
+    const MeshView mesh{ .vertices = owned_mesh->vertices, .faces = owned_mesh->faces };
+    std::stop_source stop_source = submit(
+        mesh,
+        std::move(options),
+        [owned_mesh](std::optional<UnwrapResult> unwrap_result)
+        {
+            owned_mesh->promise.set_value(std::move(unwrap_result));
+        });
+    return UnwrapHandle(std::move(result), std::move(stop_source));
+}
+
+uint32_t UnwrapPool::threadCount() const
+{
+    return scheduler_.threadCount() - 1;
+}
+
+void UnwrapPool::dispatchThread()
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        condition_.wait(
+            lock,
+            [this]()
+            {
+                return shutdown_ || ! pending_jobs_.empty();
+            });
+        std::vector<std::unique_ptr<Job>> jobs = std::move(pending_jobs_);
+        pending_jobs_.clear();
+        const bool shutdown = shutdown_;
+        lock.unlock();
+
+        // The jobs are stolen by the workers, which then run the parallel parts of all the unwrappings
+        for (std::unique_ptr<Job>& job : jobs)
+        {
+            job->task.function = &UnwrapPool::runJob;
+            job->task.user_data = job.get();
+            scheduler_.run(job->group, job->task);
+            running_jobs_.push_back(std::move(job));
+        }
+
+        // Release the jobs completed since the last submission
+        running_jobs_.remove_if(
+            [](const std::unique_ptr<Job>& job)
+            {
+                return job->group.pending_tasks.load(std::memory_order_acquire) == 0;
+            });
+
+        if (shutdown)
+        {
+            for (const std::unique_ptr<Job>& job : running_jobs_)
+            {
+                job->stop_source.request_stop();
+            }
+            for (const std::unique_ptr<Job>& job : running_jobs_)
+            {
+                scheduler_.wait(job->group);
+            }
+            running_jobs_.clear();
+            return;
+        }
+
+        lock.lock();
+    }
+}
+
+void UnwrapPool::runJob(void* user_data)
+{
+    UVULA_TRACE_ZONE("UnwrapPool::runJob");
+    auto* job = static_cast<Job*>(user_data);
+    std::optional<UnwrapResult> output;
+    UnwrapResult result;
+    if (unwrapMesh(job->mesh.vertices, job->mesh.faces, result, job->options, *job->scheduler))
+    {
+        output = std::move(result);
+    }
+
+    // The completion, and what it holds, is released on this thread, before the job itself
+    Completion completion = std::move(job->completion);
+    completion(std::move(output));
+}
@@ -0,0 +1,74 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "allocation.h"
+
+#include <new>
+
+#include "xatlas.h"
+
+
+namespace allocation
+{
+
+static ReallocFunc s_realloc = nullptr;
+static FreeFunc s_free = nullptr;
+
+/*!
+ * Memory resource forwarding to the installed allocation functions. They are expected to behave like std::realloc, so the alignment of the allocations
+ * is the one of std::max_align_t.
+ */
+class FunctionsResource : public std::pmr::memory_resource
+{
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (alignment > alignof(std::max_align_t)) [[unlikely]]
+        {
+            throw std::bad_alloc();
+        }
+
+        void* ptr = s_realloc(nullptr, bytes);
+        if (ptr == nullptr) [[unlikely]]
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t /*bytes*/, size_t /*alignment*/) override
+    {
+        if (s_free)
+        {
+            s_free(ptr);
+        }
+        else
+        {
+            s_realloc(ptr, 0);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+static FunctionsResource s_functions_resource;
+
+void setAllocationFunctions(ReallocFunc realloc_func, FreeFunc free_func)
+{
+    s_realloc = realloc_func;
+    s_free = realloc_func ? free_func : nullptr;
+    xatlas::SetAlloc(s_realloc, s_free);
+}
+
+std::pmr::memory_resource* defaultResource()
+{
+    if (s_realloc)
+    {
+        return &s_functions_resource;
+    }
+    return std::pmr::new_delete_resource();
+}
+
+}; // namespace allocation
@@ -0,0 +1,106 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "hash_utils.h"
+
+#include <bit>
+#include <cstring>
+
+namespace hash_utils
+{
+
+static constexpr uint64_t prime1 = 11400714785074694791ULL;
+static constexpr uint64_t prime2 = 14029467366897019727ULL;
+static constexpr uint64_t prime3 = 1609587929392839161ULL;
+static constexpr uint64_t prime4 = 9650029242287828579ULL;
+static constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+static uint64_t read64(const unsigned char* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const unsigned char* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * prime2;
+    accumulator = std::rotl(accumulator, 31);
+    return accumulator * prime1;
+}
+
+static uint64_t mergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= round(0, accumulator);
+    return hash * prime1 + prime4;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const auto* input = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = input + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        uint64_t lane1 = seed + prime1 + prime2;
+        uint64_t lane2 = seed + prime2;
+        uint64_t lane3 = seed;
+        uint64_t lane4 = seed - prime1;
+        const unsigned char* const limit = end - 32;
+        do
+        {
+            lane1 = round(lane1, read64(input));
+            lane2 = round(lane2, read64(input + 8));
+            lane3 = round(lane3, read64(input + 16));
+            lane4 = round(lane4, read64(input + 24));
+            input += 32;
+        } while (input <= limit);
+
+        hash = std::rotl(lane1, 1) + std::rotl(lane2, 7) + std::rotl(lane3, 12) + std::rotl(lane4, 18);
+        hash = mergeRound(hash, lane1);
+        hash = mergeRound(hash, lane2);
+        hash = mergeRound(hash, lane3);
+        hash = mergeRound(hash, lane4);
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; input + 8 <= end; input += 8)
+    {
+        hash ^= round(0, read64(input));
+        hash = std::rotl(hash, 27) * prime1 + prime4;
+    }
+
+    if (input + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(read32(input)) * prime1;
+        hash = std::rotl(hash, 23) * prime2 + prime3;
+        input += 4;
+    }
+
+    for (; input < end; ++input)
+    {
+        hash ^= static_cast<uint64_t>(*input) * prime5;
+        hash = std::rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+}; // namespace hash_utils
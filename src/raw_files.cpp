@@ -0,0 +1,81 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "raw_files.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "Face.h"
+#include "MappedFile.h"
+#include "UVCoord.h"
+#include "Vertex.h"
+
+namespace raw_files
+{
+
+size_t meshFileSize(uint64_t vertices_count, uint64_t faces_count)
+{
+    return sizeof(MeshHeader) + vertices_count * sizeof(Vertex) + faces_count * sizeof(Face);
+}
+
+size_t uvsFileSize(uint64_t faces_count)
+{
+    return sizeof(UvsHeader) + faces_count * 3 * sizeof(UVCoord);
+}
+
+bool viewMesh(const char* data, size_t size, std::span<const Vertex>& vertices, std::span<const Face>& faces)
+{
+    MeshHeader header;
+    if (data == nullptr || size < sizeof(header))
+    {
+        return false;
+    }
+
+    // The counts are checked against the size before calculating the expected size, which would overflow for crafted counts
+    std::memcpy(&header, data, sizeof(header));
+    const size_t elements_size = size - sizeof(header);
+    if (header.magic != mesh_magic || header.vertices_count > elements_size / sizeof(Vertex) || header.faces_count > elements_size / sizeof(Face)
+        || size != meshFileSize(header.vertices_count, header.faces_count))
+    {
+        return false;
+    }
+
+    // The header keeps the positions and faces aligned on their element size
+    const char* vertices_data = data + sizeof(header);
+    vertices = std::span<const Vertex>(reinterpret_cast<const Vertex*>(vertices_data), header.vertices_count);
+    faces = std::span<const Face>(reinterpret_cast<const Face*>(vertices_data + vertices.size_bytes()), header.faces_count);
+    return true;
+}
+
+bool writeMesh(const std::filesystem::path& path, std::span<const Vertex> vertices, std::span<const Face> faces)
+{
+    const MeshHeader header{ .vertices_count = vertices.size(), .faces_count = faces.size() };
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size_bytes()));
+    file.write(reinterpret_cast<const char*>(faces.data()), static_cast<std::streamsize>(faces.size_bytes()));
+    return static_cast<bool>(file);
+}
+
+bool writeUvs(const std::filesystem::path& path, uint32_t texture_width, uint32_t texture_height, std::span<const UVCoord> uv_coords, std::span<const Face> faces)
+{
+    MappedFile file(path, uvsFileSize(faces.size()));
+    char* data = file.mutableData();
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    const UvsHeader header{ .texture_width = texture_width, .texture_height = texture_height, .faces_count = faces.size() };
+    std::memcpy(data, &header, sizeof(header));
+    auto* corner_uvs = reinterpret_cast<UVCoord*>(data + sizeof(header));
+    for (const Face& face : faces)
+    {
+        *corner_uvs++ = uv_coords[face.i1];
+        *corner_uvs++ = uv_coords[face.i2];
+        *corner_uvs++ = uv_coords[face.i3];
+    }
+    return true;
+}
+
+}; // namespace raw_files
@@ -0,0 +1,177 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include "trace.h"
+
+#if defined(UVULA_TRACING_TRACY) || defined(UVULA_TRACING_CHROME)
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace
+{
+
+Total& total(const char* name)
+{
+    static std::mutex mutex;
+    // Never destroyed, so that the totals can be used until the very end of the process
+    static auto* totals = new std::map<std::string, std::unique_ptr<Total>>();
+
+    std::lock_guard lock(mutex);
+    std::unique_ptr<Total>& total = (*totals)[name];
+    if (! total)
+    {
+        total = std::make_unique<Total>();
+    }
+    return *total;
+}
+
+#ifdef UVULA_TRACING_CHROME
+
+struct Event
+{
+    const char* name;
+    char phase; // 'X' for complete events, 'C' for counters
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    Total::Values values;
+};
+
+/*!
+ * Events recorded by a single thread. The mutex is only contended when writing the file.
+ */
+struct ThreadEvents
+{
+    uint32_t thread_id;
+    std::mutex mutex;
+    std::vector<Event> events;
+};
+
+/*!
+ * Collects the events of all the threads, and writes them as a Chrome trace-event file when destroyed at the end of the process
+ */
+class Recorder
+{
+public:
+    Recorder() = default;
+
+    ~Recorder()
+    {
+        write();
+    }
+
+    Recorder(const Recorder&) = delete;
+
+    Recorder& operator=(const Recorder&) = delete;
+
+    void record(const Event& event)
+    {
+        thread_local ThreadEvents* thread_events = nullptr;
+        if (thread_events == nullptr)
+        {
+            std::lock_guard lock(mutex_);
+            threads_events_.push_back(std::make_unique<ThreadEvents>());
+            thread_events = threads_events_.back().get();
+            thread_events->thread_id = static_cast<uint32_t>(threads_events_.size());
+        }
+
+        std::lock_guard lock(thread_events->mutex);
+        thread_events->events.push_back(event);
+    }
+
+private:
+    [[nodiscard]] double timestamp(std::chrono::steady_clock::time_point time) const
+    {
+        return std::chrono::duration<double, std::micro>(time - start_).count();
+    }
+
+    void write()
+    {
+        const char* path = std::getenv("UVULA_TRACE_FILE");
+        if (path == nullptr || *path == '\0')
+        {
+            path = "uvula_trace.json";
+        }
+
+        std::FILE* file = std::fopen(path, "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Unable to write the trace file %s\n", path);
+            return;
+        }
+
+        std::lock_guard lock(mutex_);
+        std::fprintf(file, "{\"traceEvents\":[\n");
+        bool first = true;
+        for (const std::unique_ptr<ThreadEvents>& thread_events : threads_events_)
+        {
+            std::lock_guard thread_lock(thread_events->mutex);
+            const uint32_t tid = thread_events->thread_id;
+            std::fprintf(
+                file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"uvula thread %u\"}}",
+                first ? "" : ",\n",
+                tid,
+                tid);
+            first = false;
+
+            for (const Event& event : thread_events->events)
+            {
+                if (event.phase == 'X')
+                {
+                    std::fprintf(
+                        file,
+                        ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                        event.name,
+                        timestamp(event.start),
+                        std::chrono::duration<double, std::micro>(event.duration).count(),
+                        tid);
+                }
+                else
+                {
+                    std::fprintf(
+                        file,
+                        ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"calls\":%llu,\"ms\":%.3f}}",
+                        event.name,
+                        timestamp(event.start),
+                        tid,
+                        static_cast<unsigned long long>(event.values.calls),
+                        event.values.milliseconds);
+                }
+            }
+        }
+        std::fprintf(file, "\n]}\n");
+        std::fclose(file);
+    }
+
+private:
+    const std::chrono::steady_clock::time_point start_{ std::chrono::steady_clock::now() };
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadEvents>> threads_events_;
+};
+
+static Recorder& recorder()
+{
+    static Recorder recorder;
+    return recorder;
+}
+
+void recordZone(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    recorder().record(Event{ .name = name, .phase = 'X', .start = start, .duration = end - start, .values = {} });
+}
+
+void recordCounter(const char* name, const Total::Values& values)
+{
+    recorder().record(Event{ .name = name, .phase = 'C', .start = std::chrono::steady_clock::now(), .duration = {}, .values = values });
+}
+
+#endif
+
+}; // namespace trace
+
+#endif
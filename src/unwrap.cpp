@@ -3,9 +3,21 @@
 #include "unwrap.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <numeric>
+#include <optional>
 #include <set>
+#include <span>
+#include <stop_token>
+#include <utility>
 
 #include <range/v3/algorithm/partition.hpp>
 #include <range/v3/view/enumerate.hpp>
@@ -14,39 +26,48 @@
 
 #include "Face.h"
 #include "Matrix.h"
+#include "MemoryTracker.h"
+#include "MeshView.h"
+#include "MonotonicArena.h"
+#include "PackedChart.h"
+#include "ScopedXatlasAlloc.h"
+#include "TaskExecutor.h"
+#include "TaskScheduler.h"
 #include "UVCoord.h"
+#include "UnwrapHandle.h"
+#include "UnwrapOptions.h"
+#include "UnwrapResult.h"
 #include "Vector.h"
 #include "Vertex.h"
+#include "allocation.h"
 #include "geometry_utils.h"
+#include "hash_utils.h"
+#include "trace.h"
+#include "unwrap_stages.h"
 #include "xatlas.h"
 
 
-struct FaceData
-{
-    const Face* face;
-    size_t face_index;
-    Vector normal;
-};
+// Number of faces processed by each task of the parallel stages
+static constexpr size_t faces_grain_size = 4096;
 
-/*!
- * Calculate the best projection normals according to the given input faces
- * @param faces_data The faces data
- * @return A list of normals that are far enough from each other
- */
-std::vector<Vector> calculateProjectionNormals(const std::vector<FaceData>& faces_data)
+std::pmr::vector<Vector>
+    calculateProjectionNormals(const std::pmr::vector<FaceData>& faces_data, float angle_limit, TaskScheduler& scheduler, std::pmr::memory_resource* resource)
 {
-    constexpr float group_angle_limit = 20.0;
+    UVULA_TRACE_ZONE("calculateProjectionNormals");
+    const float group_angle_limit_cos = std::cos(geometry_utils::deg2rad(angle_limit));
+    const float group_angle_limit_half_cos = std::cos(geometry_utils::deg2rad(angle_limit / 2));
 
-    const float group_angle_limit_cos = std::cos(geometry_utils::deg2rad(group_angle_limit));
-    const float group_angle_limit_half_cos = std::cos(geometry_utils::deg2rad(group_angle_limit / 2));
+    std::pmr::vector<Vector> projection_normals(resource);
+    if (faces_data.empty()) [[unlikely]]
+    {
+        return projection_normals;
+    }
 
     // First group will be based on the normal of the very first face
     const Vector* project_normal = &faces_data.front().normal;
 
-    std::vector<Vector> projection_normals;
-
     // Create an internal list containing pointers to all the faces data, it will be reorganized
-    std::vector<const FaceData*> faces_to_process(faces_data.size());
+    std::pmr::vector<const FaceData*> faces_to_process(faces_data.size(), resource);
     std::transform(
         faces_data.begin(),
         faces_data.end(),
@@ -56,7 +77,7 @@ std::vector<Vector> calculateProjectionNormals(const std::vector<FaceData>& face
             return &face_data;
         });
 
-    using FaceDataIterator = std::vector<const FaceData*>::iterator;
+    using FaceDataIterator = std::pmr::vector<const FaceData*>::iterator;
     struct FaceDataRange
     {
         FaceDataIterator begin;
@@ -66,6 +87,13 @@ std::vector<Vector> calculateProjectionNormals(const std::vector<FaceData>& face
     // The unprocessed_faces is a sub-range of the faces list, that contains all the faces that have not been assigned to a group yet.
     FaceDataRange unprocessed_faces = { .begin = faces_to_process.begin(), .end = faces_to_process.end() };
 
+    struct Outlier
+    {
+        float angle;
+        FaceDataIterator face;
+    };
+    std::pmr::vector<Outlier> chunks_outliers(resource);
+
     while (true)
     {
         // Get all the faces that belong to the group of the current projection normal,
@@ -96,22 +124,39 @@ std::vector<Vector> calculateProjectionNormals(const std::vector<FaceData>& face
             projection_normals.push_back(summed_normals);
         }
 
-        // For the next iteration, try to find the most different remaining normal from all generated normals
+        // For the next iteration, try to find the most different remaining normal from all generated normals. Each chunk of faces finds its own outlier,
+        // then the chunks results are merged in order, so that the first best outlier is always selected.
+        const auto unprocessed_count = static_cast<size_t>(unprocessed_faces.end - unprocessed_faces.begin);
+        chunks_outliers.assign((unprocessed_count + faces_grain_size - 1) / faces_grain_size, Outlier{ .angle = std::numeric_limits<float>::max() });
+        scheduler.parallelFor(
+            unprocessed_count,
+            faces_grain_size,
+            [&](size_t begin, size_t end)
+            {
+                Outlier& chunk_outlier = chunks_outliers[begin / faces_grain_size];
+                for (auto iterator = unprocessed_faces.begin + begin; iterator != unprocessed_faces.begin + end; ++iterator)
+                {
+                    float face_best_angle = std::numeric_limits<float>::lowest();
+                    for (const Vector& projection_normal : projection_normals)
+                    {
+                        face_best_angle = std::max(face_best_angle, projection_normal.dot((*iterator)->normal));
+                    }
+
+                    if (face_best_angle < chunk_outlier.angle)
+                    {
+                        chunk_outlier = Outlier{ .angle = face_best_angle, .face = iterator };
+                    }
+                }
+            });
+
         float best_outlier_angle = std::numeric_limits<float>::max();
         FaceDataIterator best_outlier_face = faces_to_process.end();
-
-        for (auto iterator = unprocessed_faces.begin; iterator != unprocessed_faces.end; ++iterator)
+        for (const Outlier& chunk_outlier : chunks_outliers)
         {
-            float face_best_angle = std::numeric_limits<float>::lowest();
-            for (const Vector& projection_normal : projection_normals)
-            {
-                face_best_angle = std::max(face_best_angle, projection_normal.dot((*iterator)->normal));
-            }
-
-            if (face_best_angle < best_outlier_angle)
+            if (chunk_outlier.angle < best_outlier_angle)
             {
-                best_outlier_angle = face_best_angle;
-                best_outlier_face = iterator;
+                best_outlier_angle = chunk_outlier.angle;
+                best_outlier_face = chunk_outlier.face;
             }
         }
 
@@ -133,105 +178,188 @@ std::vector<Vector> calculateProjectionNormals(const std::vector<FaceData>& face
     return projection_normals;
 }
 
-static std::vector<FaceData> makeFacesData(const std::vector<Vertex>& vertices, const std::vector<Face>& faces)
+std::pmr::vector<FaceData> makeFacesData(std::span<const Vertex> vertices, std::span<const Face> faces, TaskScheduler& scheduler, std::pmr::memory_resource* resource)
 {
-    std::vector<FaceData> faces_data;
-    faces_data.reserve(faces.size());
+    UVULA_TRACE_ZONE("makeFacesData");
+    // Calculate the normals in parallel, then remove the faces that have no normal (e.g. degenerate) while keeping the order
+    std::pmr::vector<FaceData> faces_data(faces.size(), resource);
+    std::pmr::vector<uint8_t> has_normal(faces.size(), resource);
+    scheduler.parallelFor(
+        faces.size(),
+        faces_grain_size,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t index = begin; index < end; ++index)
+            {
+                const Face& face = faces[index];
+                const std::optional<Vector> triangle_normal = geometry_utils::triangleNormal(vertices[face.i1], vertices[face.i2], vertices[face.i3]);
+                has_normal[index] = triangle_normal.has_value();
+                if (triangle_normal.has_value())
+                {
+                    faces_data[index] = FaceData{ &face, index, triangle_normal.value() };
+                }
+            }
+        });
 
-    for (const auto& [index, face] : faces | ranges::views::enumerate)
+    size_t kept_faces = 0;
+    for (size_t index = 0; index < faces_data.size(); ++index)
     {
-        const Vertex& v1 = vertices[face.i1];
-        const Vertex& v2 = vertices[face.i2];
-        const Vertex& v3 = vertices[face.i3];
-
-        const std::optional<Vector> triangle_normal = geometry_utils::triangleNormal(v1, v2, v3);
-        if (triangle_normal.has_value())
+        if (has_normal[index])
         {
-            faces_data.push_back(FaceData{ &face, index, triangle_normal.value() });
+            faces_data[kept_faces++] = faces_data[index];
         }
     }
+    faces_data.erase(faces_data.begin() + static_cast<std::ptrdiff_t>(kept_faces), faces_data.end());
 
     return faces_data;
 }
 
-/*!
- * Groups the faces that have a similar normal, and project their points as raw UV coordinates along this normal
- * @param vertices The list of vertices positions
- * @param faces The list of faces we want to project
- * @param uv_coords The UV coordinates, which should be properly sized but the input content doesn't matter. As output, they will be filled with
- *                  raw UV coordinates that overlap and are not in the [0,1] range
- * @return A list containing grouped indices of faces
- */
-static std::vector<std::vector<size_t>> makeCharts(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, std::vector<UVCoord>& uv_coords)
+std::pmr::vector<std::pmr::vector<const FaceData*>> groupFacesByProjectionNormal(
+    const std::pmr::vector<FaceData>& faces_data,
+    const std::pmr::vector<Vector>& project_normal_array,
+    TaskScheduler& scheduler,
+    std::pmr::memory_resource* resource)
 {
-    const std::vector<FaceData> faces_data = makeFacesData(vertices, faces);
-    if (faces_data.empty()) [[unlikely]]
+    UVULA_TRACE_ZONE("groupFacesByProjectionNormal");
+    std::pmr::vector<std::pmr::vector<const FaceData*>> projected_faces_groups(project_normal_array.size(), resource);
+    if (faces_data.empty() || project_normal_array.empty()) [[unlikely]]
     {
-        return {};
+        return projected_faces_groups;
     }
 
-    // Calculate the best normals to group the faces
-    const std::vector<Vector> project_normal_array = calculateProjectionNormals(faces_data);
-    if (project_normal_array.empty()) [[unlikely]]
+    // For each face, find the best projection normal in parallel, then make groups in the faces order
+    std::pmr::vector<uint32_t> best_projection_normals(faces_data.size(), resource);
+    scheduler.parallelFor(
+        faces_data.size(),
+        faces_grain_size,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t index = begin; index < end; ++index)
+            {
+                uint32_t best_projection_normal = 0;
+                float angle_best = std::numeric_limits<float>::lowest();
+
+                for (const auto& [normal_index, projection_normal] : project_normal_array | ranges::views::enumerate)
+                {
+                    const float angle = faces_data[index].normal.dot(projection_normal);
+                    if (angle > angle_best)
+                    {
+                        angle_best = angle;
+                        best_projection_normal = static_cast<uint32_t>(normal_index);
+                    }
+                }
+
+                best_projection_normals[index] = best_projection_normal;
+            }
+        });
+
+    for (const auto& [index, face_data] : faces_data | ranges::views::enumerate)
     {
-        return {};
+        projected_faces_groups[best_projection_normals[index]].push_back(&face_data);
     }
 
-    // For each face, find the best projection normal and make groups
-    std::map<const Vector*, std::vector<const FaceData*>> projected_faces_groups;
-    for (const FaceData& face_data : faces_data)
+    return projected_faces_groups;
+}
+
+std::pmr::vector<std::pmr::vector<size_t>> makeCharts(
+    std::span<const Vertex> vertices,
+    std::span<const Face> faces,
+    const std::pmr::vector<FaceData>& faces_data,
+    const std::pmr::vector<Vector>& project_normal_array,
+    const std::pmr::vector<std::pmr::vector<const FaceData*>>& projected_faces_groups,
+    std::pmr::vector<UVCoord>& uv_coords,
+    std::pmr::vector<Face>& uv_faces,
+    std::pmr::vector<uint32_t>& uv_xref,
+    std::pmr::memory_resource* resource)
+{
+    UVULA_TRACE_ZONE("makeCharts");
+    std::pmr::vector<std::pmr::vector<size_t>> grouped_faces_indices(resource);
+    if (faces_data.empty() || project_normal_array.empty()) [[unlikely]]
+    {
+        return grouped_faces_indices;
+    }
+
+    // Now project each faces according to the closest matching normal and create indices groups. A vertex that is shared by several groups gets
+    // projected once per group. Faces of a group are processed consecutively, so keeping the last group of each vertex is enough to find its copy.
+    constexpr uint32_t no_group = std::numeric_limits<uint32_t>::max();
+    std::pmr::vector<uint32_t> vertex_last_group(vertices.size(), no_group, resource);
+    std::pmr::vector<uint32_t> vertex_last_uv(vertices.size(), resource);
+    uv_coords.clear();
+    uv_coords.reserve(vertices.size());
+    uv_xref.clear();
+    uv_xref.reserve(vertices.size());
+    uv_faces.assign(faces.begin(), faces.end());
+
+    for (const auto& [group_index, faces_data_group] : projected_faces_groups | ranges::views::enumerate)
     {
-        const Vector* best_projection_normal = nullptr;
-        float angle_best = std::numeric_limits<float>::lowest();
+        if (faces_data_group.empty())
+        {
+            continue;
+        }
 
-        for (const Vector& projection_normal : project_normal_array)
+        const Matrix axis_mat = Matrix::makeOrthogonalBasis(project_normal_array[group_index]);
+        std::pmr::vector<size_t> faces_group(resource);
+        faces_group.reserve(faces_data_group.size());
+
+        for (const FaceData* face_from_group : faces_data_group)
         {
-            const float angle = face_data.normal.dot(projection_normal);
-            if (angle > angle_best)
+            faces_group.push_back(face_from_group->face_index);
+
+            Face& uv_face = uv_faces[face_from_group->face_index];
+            for (uint32_t* vertex_index : { &uv_face.i1, &uv_face.i2, &uv_face.i3 })
             {
-                angle_best = angle;
-                best_projection_normal = &projection_normal;
+                if (vertex_last_group[*vertex_index] != group_index)
+                {
+                    vertex_last_group[*vertex_index] = group_index;
+                    vertex_last_uv[*vertex_index] = uv_coords.size();
+                    uv_coords.push_back(axis_mat.project(vertices[*vertex_index]));
+                    uv_xref.push_back(*vertex_index);
+                }
+                *vertex_index = vertex_last_uv[*vertex_index];
             }
         }
 
-        projected_faces_groups[best_projection_normal].push_back(&face_data);
+        grouped_faces_indices.push_back(std::move(faces_group));
     }
 
-    // Now project each faces according to the closest matching normal and create indices groups
-    std::vector<std::vector<size_t>> grouped_faces_indices;
-    for (const auto& [normal, faces_data] : projected_faces_groups)
+    // Faces that could not be projected (e.g. degenerate) are not part of any group, but still need to reference valid UV coordinates
+    if (faces_data.size() != faces.size())
     {
-        const Matrix axis_mat = Matrix::makeOrthogonalBasis(*normal);
-        std::vector<size_t> faces_group;
-        faces_group.reserve(faces_data.size());
+        std::pmr::vector<bool> face_projected(faces.size(), false, resource);
+        for (const FaceData& face_data : faces_data)
+        {
+            face_projected[face_data.face_index] = true;
+        }
 
-        for (const FaceData* face_from_group : faces_data)
+        for (const auto& [face_index, uv_face] : uv_faces | ranges::views::enumerate)
         {
-            faces_group.push_back(face_from_group->face_index);
+            if (face_projected[face_index])
+            {
+                continue;
+            }
 
-            for (const uint32_t vertex_index : { face_from_group->face->i1, face_from_group->face->i2, face_from_group->face->i3 })
+            for (uint32_t* vertex_index : { &uv_face.i1, &uv_face.i2, &uv_face.i3 })
             {
-                uv_coords[vertex_index] = axis_mat.project(vertices[vertex_index]);
+                if (vertex_last_group[*vertex_index] == no_group)
+                {
+                    vertex_last_group[*vertex_index] = static_cast<uint32_t>(projected_faces_groups.size());
+                    vertex_last_uv[*vertex_index] = uv_coords.size();
+                    uv_coords.push_back(UVCoord{});
+                    uv_xref.push_back(*vertex_index);
+                }
+                *vertex_index = vertex_last_uv[*vertex_index];
             }
         }
-
-        grouped_faces_indices.push_back(std::move(faces_group));
     }
 
     return grouped_faces_indices;
 }
 
-/*!
- * When projecting faces groups along a normal, it is possible that we project faces that are actually far away from each other spatially. This sometimes
- * results in overlapping projections, which we really want to avoid. The purpose of this function is to make sub-groups of faces groups for faces that are
- * adjacent to each other.
- * @param grouped_faces Contains the grouped indices of faces
- * @param faces The actual faces definitions, whose vertices should have been merged before, @sa groupSimilarVertices()
- * @return Grouped faces with groups containing only adjacent faces. It may be identical to the original groups, or contain more smaller groups
- */
-std::vector<std::vector<size_t>> splitNonLinkedFacesCharts(const std::vector<std::vector<size_t>>& grouped_faces, const std::vector<Face>& faces)
+std::pmr::vector<std::pmr::vector<size_t>>
+    splitNonLinkedFacesCharts(const std::pmr::vector<std::pmr::vector<size_t>>& grouped_faces, const std::pmr::vector<Face>& faces, std::pmr::memory_resource* resource)
 {
-    std::vector<std::vector<size_t>> result;
+    UVULA_TRACE_ZONE("splitNonLinkedFacesCharts");
+    std::pmr::vector<std::pmr::vector<size_t>> result(resource);
 
     struct AssignedVertex
     {
@@ -239,18 +367,18 @@ std::vector<std::vector<size_t>> splitNonLinkedFacesCharts(const std::vector<std
         bool assigned;
     };
 
-    for (const std::vector<size_t>& faces_group : grouped_faces)
+    for (const std::pmr::vector<size_t>& faces_group : grouped_faces)
     {
         size_t max_group_index = 0; // Incrementing group index
 
         // Keep a double cache so that we can find very quickly the group of a vertex, and all the vertices from a group
-        std::map<size_t, size_t> new_indices_groups; // vertex_index: group_index
-        std::map<size_t, std::set<size_t>> new_groups_vertices; // group_index: [vertex_index]
+        std::pmr::map<size_t, size_t> new_indices_groups(resource); // vertex_index: group_index
+        std::pmr::map<size_t, std::pmr::set<size_t>> new_groups_vertices(resource); // group_index: [vertex_index]
 
         for (const size_t face_index : faces_group)
         {
             const Face& face = faces[face_index];
-            std::set<size_t> assigned_groups;
+            std::pmr::set<size_t> assigned_groups(resource);
             std::array<AssignedVertex, 3> assigned_vertices = { AssignedVertex{ .index = face.i1 }, AssignedVertex{ .index = face.i2 }, AssignedVertex{ .index = face.i3 } };
             for (AssignedVertex& assigned_vertex : assigned_vertices)
             {
@@ -269,14 +397,14 @@ std::vector<std::vector<size_t>> splitNonLinkedFacesCharts(const std::vector<std
                 new_indices_groups[face.i1] = new_group_index;
                 new_indices_groups[face.i2] = new_group_index;
                 new_indices_groups[face.i3] = new_group_index;
-                new_groups_vertices[new_group_index] = { face.i1, face.i2, face.i3 };
+                new_groups_vertices[new_group_index].insert({ face.i1, face.i2, face.i3 });
             }
             else
             {
                 const size_t target_group = *assigned_groups.begin();
-                std::set<size_t>& target_group_vertices = new_groups_vertices[target_group];
+                std::pmr::set<size_t>& target_group_vertices = new_groups_vertices[target_group];
 
-                std::set<size_t> source_groups = assigned_groups;
+                std::pmr::set<size_t> source_groups(assigned_groups, resource);
                 source_groups.erase(source_groups.begin());
 
                 // First assign vertices that are not assigned yet
@@ -305,34 +433,28 @@ std::vector<std::vector<size_t>> splitNonLinkedFacesCharts(const std::vector<std
             }
         }
 
-        std::map<size_t, std::vector<size_t>> new_faces_groups; // group_index: [face_index]
+        std::pmr::map<size_t, std::pmr::vector<size_t>> new_faces_groups(resource); // group_index: [face_index]
         for (const size_t face_index : faces_group)
         {
             const Face& face = faces[face_index];
             new_faces_groups[new_indices_groups[face.i1]].push_back(face_index);
         }
 
-        for (const std::vector<size_t>& faces_indices : new_faces_groups | ranges::views::values)
+        for (std::pmr::vector<size_t>& faces_indices : new_faces_groups | ranges::views::values)
         {
-            result.push_back(faces_indices);
+            result.push_back(std::move(faces_indices));
         }
     }
 
     return result;
 }
 
-/*!
- * When loading the mesh, each vertex of each triangle is given a unique index, even if it is used in multiple adjacent triangles. The purpose
- * of this function is to remove double vertices so that we can make adjacency detection easier.
- * @param faces The original list of faces
- * @param vertices The original list of vertices position
- * @return The modified list of faces, which contains as many faces but with merged vertices
- */
-std::vector<Face> groupSimilarVertices(const std::vector<Face>& faces, const std::vector<Vertex>& vertices)
+std::pmr::vector<Face> groupSimilarVertices(std::span<const Face> faces, std::span<const Vertex> vertices, std::pmr::memory_resource* resource)
 {
-    std::vector<Face> faces_with_similar_indices;
-    std::map<Vertex, size_t> unique_vertices_indices;
-    std::vector<uint32_t> new_vertices_indices(vertices.size());
+    UVULA_TRACE_ZONE("groupSimilarVertices");
+    std::pmr::vector<Face> faces_with_similar_indices(resource);
+    std::pmr::map<Vertex, size_t> unique_vertices_indices(resource);
+    std::pmr::vector<uint32_t> new_vertices_indices(vertices.size(), resource);
 
     for (const auto [index, vertex] : vertices | ranges::views::enumerate)
     {
@@ -349,6 +471,7 @@ std::vector<Face> groupSimilarVertices(const std::vector<Face>& faces, const std
         }
     }
 
+    faces_with_similar_indices.reserve(faces.size());
     for (const Face& face : faces)
     {
         faces_with_similar_indices.push_back(Face{ new_vertices_indices[face.i1], new_vertices_indices[face.i2], new_vertices_indices[face.i3] });
@@ -358,32 +481,90 @@ std::vector<Face> groupSimilarVertices(const std::vector<Face>& faces, const std
 }
 
 /*!
- * Packs the charts (faces groups) onto a texture image by using as much space as possible without having them overlap
- * @param vertices The list of vertices position
- * @param faces The list of vertices position
- * @param charts The list of grouped faces indices
- * @param uv_coords The original UV coordinates, which may be overlapping and not fitting on an image. As an output they
- *                  will be properly scaled and distributed on the image.
- * @param texture_width Output width to be used for the texture image
- * @param texture_height Output height to be used for the texture image
- * @return
+ * Fills the charts of the result from the output mesh of xatlas, once the UV coordinates, charts of the vertices and texture size of the result are set
  */
+static void makePackedCharts(const xatlas::Mesh& output_mesh, UnwrapResult& result)
+{
+    size_t faces_count = 0;
+    for (uint32_t chart_index = 0; chart_index < output_mesh.chartCount; ++chart_index)
+    {
+        faces_count += output_mesh.chartArray[chart_index].faceCount;
+    }
+
+    result.charts.resize(output_mesh.chartCount);
+    result.chart_faces.clear();
+    result.chart_faces.reserve(faces_count);
+    for (uint32_t chart_index = 0; chart_index < output_mesh.chartCount; ++chart_index)
+    {
+        const xatlas::Chart& chart = output_mesh.chartArray[chart_index];
+        PackedChart& packed_chart = result.charts[chart_index];
+        packed_chart.first_face = static_cast<uint32_t>(result.chart_faces.size());
+        packed_chart.faces_count = chart.faceCount;
+        packed_chart.rotated = chart.rotated;
+        result.chart_faces.insert(result.chart_faces.end(), chart.faceArray, chart.faceArray + chart.faceCount);
+    }
+
+    // The bounding rectangles enclose all the texels touched by the vertices of the charts
+    constexpr float max_coordinate = std::numeric_limits<float>::max();
+    std::vector<std::pair<UVCoord, UVCoord>> bounds(
+        result.charts.size(),
+        { UVCoord{ .u = max_coordinate, .v = max_coordinate }, UVCoord{ .u = -max_coordinate, .v = -max_coordinate } });
+    for (size_t index = 0; index < result.uv_coords.size(); ++index)
+    {
+        const int32_t chart_index = result.vertex_chart[index];
+        if (chart_index >= 0)
+        {
+            auto& [min, max] = bounds[chart_index];
+            const UVCoord& uv_coord = result.uv_coords[index];
+            min = UVCoord{ .u = std::min(min.u, uv_coord.u), .v = std::min(min.v, uv_coord.v) };
+            max = UVCoord{ .u = std::max(max.u, uv_coord.u), .v = std::max(max.v, uv_coord.v) };
+        }
+    }
+
+    const auto texture_width = static_cast<float>(result.texture_width);
+    const auto texture_height = static_cast<float>(result.texture_height);
+    for (size_t chart_index = 0; chart_index < result.charts.size(); ++chart_index)
+    {
+        const auto& [min, max] = bounds[chart_index];
+        if (min.u > max.u)
+        {
+            continue;
+        }
+
+        PackedChart& packed_chart = result.charts[chart_index];
+        const auto left = static_cast<uint32_t>(std::clamp(std::floor(min.u * texture_width), 0.0F, texture_width));
+        const auto top = static_cast<uint32_t>(std::clamp(std::floor(min.v * texture_height), 0.0F, texture_height));
+        const auto right = static_cast<uint32_t>(std::clamp(std::ceil(max.u * texture_width), 0.0F, texture_width));
+        const auto bottom = static_cast<uint32_t>(std::clamp(std::ceil(max.v * texture_height), 0.0F, texture_height));
+        packed_chart.x = left;
+        packed_chart.y = top;
+        packed_chart.width = right - left;
+        packed_chart.height = bottom - top;
+    }
+}
+
 bool packCharts(
-    const std::vector<Vertex>& vertices,
-    const std::vector<Face>& faces,
-    const std::vector<std::vector<size_t>>& charts,
-    std::vector<UVCoord>& uv_coords,
-    uint32_t& texture_width,
-    uint32_t& texture_height)
+    UnwrapContext& context,
+    const std::pmr::vector<Face>& uv_faces,
+    const std::pmr::vector<std::pmr::vector<size_t>>& charts,
+    const std::pmr::vector<UVCoord>& uv_coords,
+    const std::pmr::vector<uint32_t>& uv_xref,
+    UnwrapResult& result,
+    const xatlas::PackOptions& pack_options)
 {
+    UVULA_TRACE_ZONE("packCharts");
     // Create an xatlas object and register the mesh with the basic UV coordinates
-    xatlas::Atlas* atlas = xatlas::Create();
+    if (! context.enterStage(UnwrapStage::AddUvMesh))
+    {
+        return false;
+    }
+    xatlas::Atlas* atlas = xatlas::Create(context.scheduler);
     xatlas::UvMeshDecl mesh;
     mesh.vertexUvData = uv_coords.data();
-    mesh.indexData = faces.data();
-    mesh.vertexCount = vertices.size();
+    mesh.indexData = uv_faces.data();
+    mesh.vertexCount = uv_coords.size();
     mesh.vertexStride = sizeof(UVCoord);
-    mesh.indexCount = faces.size() * 3;
+    mesh.indexCount = uv_faces.size() * 3;
     mesh.indexFormat = xatlas::IndexFormat::UInt32;
 
     if (xatlas::AddUvMesh(atlas, mesh) != xatlas::AddMeshError::Success)
@@ -393,48 +574,345 @@ bool packCharts(
         return false;
     }
 
-    // Use a smaller calculation definition, which makes the calculation much faster and adds more margin between the islands, then scale it up
-    constexpr uint32_t calculation_definition = 512;
-    constexpr uint32_t desired_definition = 4096;
-
     // Set the pre-calculated faces groups
+    if (! context.enterStage(UnwrapStage::SetCharts))
+    {
+        xatlas::Destroy(atlas);
+        return false;
+    }
     xatlas::SetCharts(atlas, charts);
 
-    // Now pack the charts on the image
-    constexpr xatlas::PackOptions pack_options{ .padding = 0, .resolution = calculation_definition };
+    // Now pack the charts on the image. xatlas reports the steps of the packing, which are then tracked as stages of the unwrapping, and can be cancelled
+    // before each chart.
+    xatlas::SetProgressCallback(
+        atlas,
+        [](xatlas::ProgressCategory category, int progress, void* user_data)
+        {
+            auto* context = static_cast<UnwrapContext*>(user_data);
+            UnwrapStage stage = UnwrapStage::Output;
+            switch (category)
+            {
+            case xatlas::ProgressCategory::PrepareCharts:
+                stage = UnwrapStage::ChartsPreprocessing;
+                break;
+            case xatlas::ProgressCategory::RasterizeCharts:
+                stage = UnwrapStage::Rasterization;
+                break;
+            case xatlas::ProgressCategory::PlaceCharts:
+                stage = UnwrapStage::Placement;
+                break;
+            case xatlas::ProgressCategory::BuildOutputMeshes:
+                stage = UnwrapStage::Output;
+                break;
+            }
+
+            // The rasterization and placement alternate for each chart, so they are switched without reporting a stage change each time
+            const float fraction = static_cast<float>(progress) / 100.0F;
+            if (stage == UnwrapStage::Rasterization || stage == UnwrapStage::Placement)
+            {
+                return context->switchStage(stage, fraction);
+            }
+            return context->current_stage == stage ? context->reportProgress(stage, fraction) : context->enterStage(stage, fraction);
+        },
+        &context);
     xatlas::PackCharts(atlas, pack_options);
+    if (context.options->stop_token.stop_requested())
+    {
+        xatlas::Destroy(atlas);
+        return false;
+    }
+
+    result.stats.charts_count = atlas->chartCount;
+    if (atlas->atlasCount > 0)
+    {
+        result.stats.utilization = std::accumulate(atlas->utilization, atlas->utilization + atlas->atlasCount, 0.0F) / static_cast<float>(atlas->atlasCount);
+    }
 
     // Now scale up the size
-    texture_width = atlas->width;
-    texture_height = atlas->height;
-    const uint32_t max_side = std::max(texture_width, texture_height);
-    const double scale = static_cast<double>(desired_definition) / static_cast<double>(max_side);
-    texture_width = std::llrint(texture_width * scale);
-    texture_height = std::llrint(texture_height * scale);
+    result.stats.atlas_width = atlas->width;
+    result.stats.atlas_height = atlas->height;
+    if (atlas->image != nullptr)
+    {
+        result.atlas_image.assign(atlas->image, atlas->image + static_cast<size_t>(atlas->width) * atlas->height);
+    }
+    result.texture_width = atlas->width;
+    result.texture_height = atlas->height;
+    const uint32_t max_side = std::max(result.texture_width, result.texture_height);
+    const double scale = static_cast<double>(texture_definition) / static_cast<double>(max_side);
+    result.texture_width = std::llrint(result.texture_width * scale);
+    result.texture_height = std::llrint(result.texture_height * scale);
 
     // Convert the output data
     const xatlas::Mesh& output_mesh = *atlas->meshes;
     const auto width = static_cast<float>(atlas->width);
     const auto height = static_cast<float>(atlas->height);
+    result.uv_coords.resize(output_mesh.vertexCount);
+    result.vertex_xref.resize(output_mesh.vertexCount);
+    result.vertex_chart.resize(output_mesh.vertexCount);
     for (size_t i = 0; i < output_mesh.vertexCount; ++i)
     {
         const xatlas::PlacedVertex& vertex = output_mesh.vertexArray[i];
-        uv_coords[vertex.xref] = UVCoord{ .u = vertex.uv[0] / width, .v = vertex.uv[1] / height };
+        result.uv_coords[i] = UVCoord{ .u = vertex.uv[0] / width, .v = vertex.uv[1] / height };
+        result.vertex_xref[i] = uv_xref[vertex.xref];
+        result.vertex_chart[i] = vertex.chartIndex;
+    }
+
+    result.faces.resize(output_mesh.indexCount / 3);
+    for (size_t i = 0; i < result.faces.size(); ++i)
+    {
+        const uint32_t* indices = &output_mesh.indexArray[i * 3];
+        result.faces[i] = Face{ indices[0], indices[1], indices[2] };
     }
 
+    makePackedCharts(output_mesh, result);
+
+    // Hash the output, so that results can be compared or cached without keeping them
+    result.uv_hash = calculateUvHash(result);
+
     xatlas::Destroy(atlas);
     return true;
 }
 
-bool smartUnwrap(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, std::vector<UVCoord>& uv_coords, uint32_t& texture_width, uint32_t& texture_height)
+void makeScheduler(std::optional<TaskScheduler>& scheduler, const UnwrapOptions& options)
+{
+    if (options.executor != nullptr)
+    {
+        scheduler.emplace(*options.executor, options.thread_count);
+    }
+    else
+    {
+        scheduler.emplace(options.thread_count > 0 ? options.thread_count : TaskScheduler::defaultThreadCount(), options.pin_threads);
+    }
+}
+
+bool unwrapMesh(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options, TaskScheduler& scheduler)
 {
-    // Make a first projection and grouping of the faces to UV coordinates
-    std::vector<std::vector<size_t>> charts = makeCharts(vertices, faces, uv_coords);
+    // All the temporary data is released at the end of this scope, at once when using an arena
+    UnwrapContext context{ .options = &options, .scheduler = &scheduler };
+    std::optional<MonotonicArena> arena;
+    std::optional<MemoryTracker> memory_tracker;
+    std::pmr::memory_resource* resource = allocation::defaultResource();
+    std::optional<xatlas::AllocCallbacks> xatlas_callbacks; // By default, xatlas uses the installed allocation functions
+    if (options.arena_size > 0)
+    {
+        arena.emplace(options.arena_size);
+        resource = &*arena;
+        xatlas_callbacks = xatlas::AllocCallbacks{ .realloc = &MonotonicArena::reallocate, .free = &MonotonicArena::release, .userData = &*arena };
+    }
+    if (options.track_memory)
+    {
+        memory_tracker.emplace(resource);
+        resource = &*memory_tracker;
+        xatlas_callbacks = xatlas::AllocCallbacks{ .realloc = &MemoryTracker::reallocate, .free = &MemoryTracker::release, .userData = &*memory_tracker };
+        context.memory_tracker = &*memory_tracker;
+    }
+    const ScopedXatlasAlloc xatlas_alloc(xatlas_callbacks);
+
+    // Calculate the best normals to group the faces
+    if (! context.enterStage(UnwrapStage::FacesData))
+    {
+        return false;
+    }
+    const std::pmr::vector<FaceData> faces_data = makeFacesData(vertices, faces, scheduler, resource);
+
+    if (! context.enterStage(UnwrapStage::ProjectionNormals))
+    {
+        return false;
+    }
+    const std::pmr::vector<Vector> project_normal_array = calculateProjectionNormals(faces_data, options.angle_limit, scheduler, resource);
+
+    // Make a first grouping of the faces, and project them to UV coordinates
+    if (! context.enterStage(UnwrapStage::Clustering))
+    {
+        return false;
+    }
+    const std::pmr::vector<std::pmr::vector<const FaceData*>> projected_faces_groups
+        = groupFacesByProjectionNormal(faces_data, project_normal_array, scheduler, resource);
+
+    if (! context.enterStage(UnwrapStage::Projection))
+    {
+        return false;
+    }
+    std::pmr::vector<UVCoord> uv_coords(resource);
+    std::pmr::vector<Face> uv_faces(resource);
+    std::pmr::vector<uint32_t> uv_xref(resource);
+    std::pmr::vector<std::pmr::vector<size_t>> charts
+        = makeCharts(vertices, faces, faces_data, project_normal_array, projected_faces_groups, uv_coords, uv_faces, uv_xref, resource);
 
     // Split faces group to get only groups of adjacent faces
-    std::vector<Face> const faces_with_similar_indices = groupSimilarVertices(faces, vertices);
-    charts = splitNonLinkedFacesCharts(charts, faces_with_similar_indices);
+    if (! context.enterStage(UnwrapStage::Welding))
+    {
+        return false;
+    }
+    const std::pmr::vector<Face> faces_with_similar_indices = groupSimilarVertices(faces, vertices, resource);
+
+    if (! context.enterStage(UnwrapStage::SplitCharts))
+    {
+        return false;
+    }
+    charts = splitNonLinkedFacesCharts(charts, faces_with_similar_indices, resource);
 
     // Now pack the UV coordinates onto a proper image surface
-    return packCharts(vertices, faces, charts, uv_coords, texture_width, texture_height);
+    xatlas::PackOptions pack_options = default_pack_options;
+    pack_options.padding = options.padding;
+    pack_options.resolution = options.resolution;
+    pack_options.bruteForce = options.brute_force;
+    pack_options.seed = options.seed;
+    pack_options.createImage = options.create_image;
+    const bool packed = packCharts(context, uv_faces, charts, uv_coords, uv_xref, result, pack_options);
+    context.leaveStage();
+    result.stats.stage_durations = context.stage_durations;
+
+    if (memory_tracker.has_value())
+    {
+        result.stats.peak_memory = memory_tracker->peakSize();
+        for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+        {
+            result.stats.stage_peak_memory[stage] = memory_tracker->stagePeakSize(static_cast<UnwrapStage>(stage));
+        }
+    }
+
+    return packed;
+}
+
+bool smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, UnwrapResult& result, const UnwrapOptions& options)
+{
+    UVULA_TRACE_ZONE("smartUnwrap");
+    std::optional<TaskScheduler> scheduler;
+    makeScheduler(scheduler, options);
+    const bool unwrapped = unwrapMesh(vertices, faces, result, options, *scheduler);
+    result.stats.workers = scheduler->workerStats();
+    return unwrapped;
+}
+
+std::vector<std::optional<UnwrapResult>> smartUnwrapMany(std::span<const MeshView> meshes, const UnwrapOptions& options)
+{
+    UVULA_TRACE_ZONE("smartUnwrapMany");
+    std::optional<TaskScheduler> scheduler;
+    makeScheduler(scheduler, options);
+
+    // Each mesh is a task, whose own parallel tasks are run by the same threads, so that the threads are kept busy by the other meshes while a mesh is
+    // in a sequential part
+    std::vector<std::optional<UnwrapResult>> results(meshes.size());
+    scheduler->parallelFor(
+        meshes.size(),
+        1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t index = begin; index < end; ++index)
+            {
+                UnwrapResult result;
+                if (unwrapMesh(meshes[index].vertices, meshes[index].faces, result, options, *scheduler))
+                {
+                    results[index] = std::move(result);
+                }
+            }
+        });
+
+    return results;
+}
+
+/*!
+ * Unwrapping started by smartUnwrapAsync(), owning its input until it is run
+ */
+struct AsyncUnwrap
+{
+    std::vector<Vertex> vertices;
+    std::vector<Face> faces;
+    UnwrapOptions options;
+    std::stop_source stop_source; // Source of the handle, which is the one checked by the unwrapping
+
+    std::optional<UnwrapResult> run()
+    {
+        // Forward the stop requests of the caller to the source of the handle
+        const std::stop_callback forward_stop(options.stop_token, [this]() { stop_source.request_stop(); });
+        options.stop_token = stop_source.get_token();
+
+        UnwrapResult unwrap_result;
+        if (! smartUnwrap(vertices, faces, unwrap_result, options))
+        {
+            return std::nullopt;
+        }
+        return unwrap_result;
+    }
+};
+
+UnwrapHandle smartUnwrapAsync(std::vector<Vertex> vertices, std::vector<Face> faces, UnwrapOptions options)
+{
+    std::stop_source stop_source;
+    TaskExecutor* executor = options.executor;
+    auto unwrap = std::make_unique<AsyncUnwrap>(
+        AsyncUnwrap{ .vertices = std::move(vertices), .faces = std::move(faces), .options = std::move(options), .stop_source = stop_source });
+    if (executor == nullptr)
+    {
+        std::future<std::optional<UnwrapResult>> result = std::async(
+            std::launch::async,
+            [unwrap = std::move(unwrap)]()
+            {
+                return unwrap->run();
+            });
+        return UnwrapHandle(std::move(result), std::move(stop_source));
+    }
+
+    // The unwrapping is run as a job of the executor, which fulfills the promise and releases the job
+    struct ExecutorJob
+    {
+        std::unique_ptr<AsyncUnwrap> unwrap;
+        std::promise<std::optional<UnwrapResult>> promise;
+    };
+
+    auto job = std::make_unique<ExecutorJob>(ExecutorJob{ .unwrap = std::move(unwrap) });
+    std::future<std::optional<UnwrapResult>> result = job->promise.get_future();
+    executor->execute(
+        [](void* user_data)
+        {
+            const std::unique_ptr<ExecutorJob> job(static_cast<ExecutorJob*>(user_data));
+            try
+            {
+                job->promise.set_value(job->unwrap->run());
+            }
+            catch (...)
+            {
+                job->promise.set_exception(std::current_exception());
+            }
+        },
+        job.release());
+    return UnwrapHandle(std::move(result), std::move(stop_source));
+}
+
+bool smartUnwrap(std::span<const Vertex> vertices, std::span<const Face> faces, std::vector<UVCoord>& uv_coords, uint32_t& texture_width, uint32_t& texture_height)
+{
+    UnwrapResult result;
+    if (! smartUnwrap(vertices, faces, result))
+    {
+        return false;
+    }
+
+    // Split vertices can only store one of their UV coordinates
+    for (const auto& [index, uv_coord] : result.uv_coords | ranges::views::enumerate)
+    {
+        uv_coords[result.vertex_xref[index]] = uv_coord;
+    }
+
+    texture_width = result.texture_width;
+    texture_height = result.texture_height;
+    return true;
+}
+
+size_t estimateUnwrapMemory(size_t vertex_count, size_t face_count)
+{
+    // Measured on noisy meshes, which produce many small charts and are the worst case. Smooth meshes usually use 2 to 3 times less memory.
+    constexpr size_t base_size = 2'500'000; // Mostly the images used to pack the charts
+    constexpr size_t size_per_vertex = 16;
+    constexpr size_t size_per_face = 565;
+
+    return base_size + (vertex_count * size_per_vertex) + (face_count * size_per_face);
+}
+
+uint64_t calculateUvHash(const UnwrapResult& result)
+{
+    uint64_t hash = hash_utils::hashBytes(result.uv_coords.data(), result.uv_coords.size() * sizeof(UVCoord));
+    hash = hash_utils::hashBytes(result.faces.data(), result.faces.size() * sizeof(Face), hash);
+    const std::array<uint32_t, 2> texture_size{ result.texture_width, result.texture_height };
+    return hash_utils::hashBytes(texture_size.data(), sizeof(texture_size), hash);
 }
@@ -0,0 +1,745 @@
+// (c) 2025, UltiMaker -- see LICENCE for details
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <range/v3/view/enumerate.hpp>
+#include <spdlog/spdlog.h>
+
+#include "Face.h"
+#include "FaceData.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+#include "ScopedXatlasAlloc.h"
+#include "TaskScheduler.h"
+#include "UVCoord.h"
+#include "UnwrapContext.h"
+#include "UnwrapOptions.h"
+#include "UnwrapResult.h"
+#include "Vector.h"
+#include "Vertex.h"
+#include "allocation.h"
+#include "geometry_utils.h"
+#include "hash_utils.h"
+#include "raw_files.h"
+#include "trace.h"
+#include "unwrap.h"
+#include "unwrap_stages.h"
+
+/*
+ * Out-of-core unwrapping of a mesh file, see smartUnwrapFile()
+ */
+
+// Estimated peak amount of memory used to unwrap a face, including the data of xatlas, which sets the number of faces unwrapped at once
+static constexpr size_t batch_bytes_per_face = 640;
+
+// Minimum number of faces of the chunks and batches, so that tiny budgets still progress
+static constexpr size_t min_chunk_faces = 4096;
+
+// Maximum number of faces of the chunks streamed from the input file
+static constexpr size_t max_chunk_faces = size_t(1) << 22;
+
+// Maximum number of cells along each axis of the grid splitting the groups into batches
+static constexpr uint32_t max_cells_per_axis = 64;
+
+// Number of faces buffered before being written to their spill file
+static constexpr size_t spill_buffer_faces = 8192;
+
+/*!
+ * Face assigned to a projection normal, as stored in the spill file of the normal
+ */
+struct SpilledFace
+{
+    uint32_t face_index;
+    uint32_t cell; // Cell of the grid containing the center of the face
+};
+
+/*!
+ * Data of a face of a chunk, calculated in parallel
+ */
+struct ChunkFace
+{
+    Vector normal;
+    float best_dot;
+    uint32_t group;
+    uint32_t cell;
+    bool valid;
+};
+
+/*!
+ * Faces projected along the same normal, spilled to a temporary file. The faces are written in order, and can be read back several times.
+ */
+class SpillFile
+{
+public:
+    SpillFile(std::filesystem::path path, size_t cells_count)
+        : path_(std::move(path))
+        , stream_(path_, std::ios::binary | std::ios::trunc | std::ios::in | std::ios::out)
+        , cell_faces_count_(cells_count, 0)
+    {
+        buffer_.reserve(spill_buffer_faces);
+    }
+
+    void write(const SpilledFace& face)
+    {
+        buffer_.push_back(face);
+        ++cell_faces_count_[face.cell];
+        if (buffer_.size() == spill_buffer_faces)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        stream_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size() * sizeof(SpilledFace)));
+        buffer_.clear();
+    }
+
+    [[nodiscard]] bool good() const
+    {
+        return stream_.good();
+    }
+
+    /*! @return The number of faces of the group in each cell */
+    [[nodiscard]] const std::vector<uint64_t>& cellFacesCount() const
+    {
+        return cell_faces_count_;
+    }
+
+    /*!
+     * Reads back the indices of the faces of a range of cells
+     * @param first_cell The first cell of the range
+     * @param end_cell The cell after the last one of the range
+     * @param faces The indices of the faces in the range, in the order they were written
+     */
+    void read(uint32_t first_cell, uint32_t end_cell, std::pmr::vector<uint32_t>& faces)
+    {
+        faces.clear();
+        stream_.clear();
+        stream_.seekg(0);
+        while (stream_.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(spill_buffer_faces * sizeof(SpilledFace))) || stream_.gcount() > 0)
+        {
+            const auto read_faces = static_cast<size_t>(stream_.gcount()) / sizeof(SpilledFace);
+            for (const SpilledFace& face : std::span(buffer_.data(), read_faces))
+            {
+                if (face.cell >= first_cell && face.cell < end_cell)
+                {
+                    faces.push_back(face.face_index);
+                }
+            }
+        }
+        stream_.clear();
+    }
+
+    /*! Allocates the buffer to read the faces back, once they have all been written and flushed */
+    void prepareReading()
+    {
+        buffer_.resize(spill_buffer_faces);
+    }
+
+private:
+    std::filesystem::path path_;
+    std::fstream stream_;
+    std::vector<SpilledFace> buffer_;
+    std::vector<uint64_t> cell_faces_count_;
+};
+
+/*!
+ * Directory of the spill files, removed with its content when the unwrapping is done
+ */
+class SpillDirectory
+{
+public:
+    explicit SpillDirectory(std::filesystem::path path)
+        : path_(std::move(path))
+    {
+        std::error_code error;
+        std::filesystem::create_directories(path_, error);
+    }
+
+    ~SpillDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+
+    SpillDirectory(const SpillDirectory&) = delete;
+
+    SpillDirectory& operator=(const SpillDirectory&) = delete;
+
+    [[nodiscard]] const std::filesystem::path& path() const
+    {
+        return path_;
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+/*!
+ * Faces of a group that are unwrapped and packed together, then laid out on the texture
+ */
+struct Batch
+{
+    uint32_t group;
+    uint32_t first_cell;
+    uint32_t end_cell;
+    uint32_t width{ 0 }; // Size of the atlas of the batch, in texels
+    uint32_t height{ 0 };
+    uint32_t x{ 0 }; // Location of the atlas of the batch on the whole atlas, in texels
+    uint32_t y{ 0 };
+};
+
+/*!
+ * Grid splitting the bounding box of the mesh, to gather spatially close faces in the same batches
+ */
+class CellGrid
+{
+public:
+    CellGrid(std::span<const Vertex> vertices, uint32_t cells_per_axis)
+        : cells_per_axis_(cells_per_axis)
+    {
+        for (const Vertex& vertex : vertices)
+        {
+            min_ = { std::min(min_[0], vertex.x), std::min(min_[1], vertex.y), std::min(min_[2], vertex.z) };
+            max_ = { std::max(max_[0], vertex.x), std::max(max_[1], vertex.y), std::max(max_[2], vertex.z) };
+        }
+    }
+
+    [[nodiscard]] uint32_t cellsCount() const
+    {
+        return cells_per_axis_ * cells_per_axis_ * cells_per_axis_;
+    }
+
+    [[nodiscard]] uint32_t cell(const Vertex& v1, const Vertex& v2, const Vertex& v3) const
+    {
+        const std::array<float, 3> center{ (v1.x + v2.x + v3.x) / 3.0F, (v1.y + v2.y + v3.y) / 3.0F, (v1.z + v2.z + v3.z) / 3.0F };
+        uint32_t cell = 0;
+        for (size_t axis = 3; axis-- > 0;)
+        {
+            const float extent = max_[axis] - min_[axis];
+            const float position = extent > 0.0F ? (center[axis] - min_[axis]) / extent : 0.0F;
+            const auto coordinate = static_cast<uint32_t>(std::clamp(position * static_cast<float>(cells_per_axis_), 0.0F, static_cast<float>(cells_per_axis_ - 1)));
+            cell = cell * cells_per_axis_ + coordinate;
+        }
+        return cell;
+    }
+
+private:
+    uint32_t cells_per_axis_;
+    std::array<float, 3> min_{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    std::array<float, 3> max_{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+};
+
+/*!
+ * Calls a function on consecutive chunks of the faces, and reports the progress of the current stage after each of them
+ * @return False if the unwrapping has been cancelled
+ */
+template<typename Function>
+static bool forEachChunk(UnwrapContext& context, UnwrapStage stage, size_t faces_count, size_t chunk_faces, Function&& function)
+{
+    for (size_t chunk_begin = 0; chunk_begin < faces_count; chunk_begin += chunk_faces)
+    {
+        const size_t chunk_end = std::min(chunk_begin + chunk_faces, faces_count);
+        function(chunk_begin, chunk_end);
+        if (! context.reportProgress(stage, static_cast<float>(chunk_end) / static_cast<float>(faces_count)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Unwraps and packs the faces of a batch, and writes their UV coordinates in texels of the atlas of the batch
+ * @return False if the unwrapping failed or has been cancelled
+ */
+static bool unwrapBatch(
+    UnwrapContext& context,
+    std::span<const Vertex> vertices,
+    std::span<const Face> faces,
+    const std::pmr::vector<uint32_t>& batch_faces,
+    const Vector& projection_normal,
+    const xatlas::PackOptions& pack_options,
+    UVCoord* corner_uvs,
+    Batch& batch,
+    UnwrapResult& result,
+    double& covered_texels,
+    std::pmr::memory_resource* resource)
+{
+    UVULA_TRACE_ZONE("unwrapBatch");
+    if (! context.enterStage(UnwrapStage::Projection))
+    {
+        return false;
+    }
+
+    // Copy the faces of the batch and the vertices they use, which are scattered in the input file
+    std::pmr::unordered_map<uint32_t, uint32_t> local_indices(resource);
+    local_indices.reserve(batch_faces.size());
+    std::pmr::vector<Vertex> local_vertices(resource);
+    std::pmr::vector<Face> local_faces(resource);
+    local_faces.reserve(batch_faces.size());
+    for (const uint32_t face_index : batch_faces)
+    {
+        Face local_face = faces[face_index];
+        for (uint32_t* vertex_index : { &local_face.i1, &local_face.i2, &local_face.i3 })
+        {
+            const auto [iterator, inserted] = local_indices.try_emplace(*vertex_index, static_cast<uint32_t>(local_vertices.size()));
+            if (inserted)
+            {
+                local_vertices.push_back(vertices[*vertex_index]);
+            }
+            *vertex_index = iterator->second;
+        }
+        local_faces.push_back(local_face);
+    }
+    local_indices = std::pmr::unordered_map<uint32_t, uint32_t>(resource);
+
+    // All the faces of the batch are projected along the normal of their group
+    const std::pmr::vector<FaceData> faces_data = makeFacesData(local_vertices, local_faces, *context.scheduler, resource);
+    const std::pmr::vector<Vector> projection_normals({ projection_normal }, resource);
+    std::pmr::vector<std::pmr::vector<const FaceData*>> projected_faces_groups(1, resource);
+    projected_faces_groups.front().reserve(faces_data.size());
+    for (const FaceData& face_data : faces_data)
+    {
+        projected_faces_groups.front().push_back(&face_data);
+    }
+
+    std::pmr::vector<UVCoord> uv_coords(resource);
+    std::pmr::vector<Face> uv_faces(resource);
+    std::pmr::vector<uint32_t> uv_xref(resource);
+    std::pmr::vector<std::pmr::vector<size_t>> charts
+        = makeCharts(local_vertices, local_faces, faces_data, projection_normals, projected_faces_groups, uv_coords, uv_faces, uv_xref, resource);
+
+    if (! context.enterStage(UnwrapStage::Welding))
+    {
+        return false;
+    }
+    const std::pmr::vector<Face> faces_with_similar_indices = groupSimilarVertices(local_faces, local_vertices, resource);
+
+    if (! context.enterStage(UnwrapStage::SplitCharts))
+    {
+        return false;
+    }
+    charts = splitNonLinkedFacesCharts(charts, faces_with_similar_indices, resource);
+
+    UnwrapResult batch_result;
+    if (! packCharts(context, uv_faces, charts, uv_coords, uv_xref, batch_result, pack_options))
+    {
+        return false;
+    }
+
+    // The output faces are in the order of the faces of the batch
+    batch.width = batch_result.stats.atlas_width;
+    batch.height = batch_result.stats.atlas_height;
+    const auto width = static_cast<float>(batch.width);
+    const auto height = static_cast<float>(batch.height);
+    for (size_t index = 0; index < batch_faces.size(); ++index)
+    {
+        const Face& face = batch_result.faces[index];
+        UVCoord* face_uvs = corner_uvs + static_cast<size_t>(batch_faces[index]) * 3;
+        for (const uint32_t vertex_index : { face.i1, face.i2, face.i3 })
+        {
+            const UVCoord& uv_coord = batch_result.uv_coords[vertex_index];
+            *face_uvs++ = UVCoord{ .u = uv_coord.u * width, .v = uv_coord.v * height };
+        }
+    }
+
+    result.stats.charts_count += batch_result.stats.charts_count;
+    covered_texels += static_cast<double>(batch_result.stats.utilization) * width * height;
+    return true;
+}
+
+/*!
+ * Lays out the atlases of the batches in rows, from the tallest to the shortest
+ * @param batches The batches, whose location is set
+ * @param gap The number of texels left between the batches
+ * @return The size of the whole atlas, in texels
+ */
+static std::pair<uint32_t, uint32_t> layOutBatches(std::vector<Batch>& batches, uint32_t gap)
+{
+    std::vector<Batch*> sorted_batches;
+    double total_area = 0.0;
+    uint32_t max_width = 0;
+    for (Batch& batch : batches)
+    {
+        sorted_batches.push_back(&batch);
+        total_area += static_cast<double>(batch.width + gap) * static_cast<double>(batch.height + gap);
+        max_width = std::max(max_width, batch.width + gap);
+    }
+    std::stable_sort(
+        sorted_batches.begin(),
+        sorted_batches.end(),
+        [](const Batch* lhs, const Batch* rhs)
+        {
+            return lhs->height > rhs->height;
+        });
+
+    // Rows about as wide as the whole atlas is tall
+    const uint32_t row_width = std::max(max_width, static_cast<uint32_t>(std::ceil(std::sqrt(total_area))));
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t row_height = 0;
+    uint32_t width = 0;
+    for (Batch* batch : sorted_batches)
+    {
+        if (x + batch->width + gap > row_width && x > 0)
+        {
+            y += row_height;
+            x = 0;
+            row_height = 0;
+        }
+        batch->x = x;
+        batch->y = y;
+        x += batch->width + gap;
+        row_height = std::max(row_height, batch->height + gap);
+        width = std::max(width, x);
+    }
+
+    return { std::max(width, gap + 1) - gap, std::max(y + row_height, gap + 1) - gap };
+}
+
+bool smartUnwrapFile(
+    const std::filesystem::path& input_path,
+    const std::filesystem::path& output_path,
+    size_t memory_budget,
+    UnwrapResult& result,
+    const UnwrapOptions& options)
+{
+    UVULA_TRACE_ZONE("smartUnwrapFile");
+    result = UnwrapResult{};
+    MappedFile input(input_path);
+    std::span<const Vertex> vertices;
+    std::span<const Face> faces;
+    if (! raw_files::viewMesh(input.data(), input.size(), vertices, faces))
+    {
+        spdlog::error("{} is not a valid raw mesh file", input_path.string());
+        return false;
+    }
+    if (faces.size() > std::numeric_limits<uint32_t>::max())
+    {
+        spdlog::error("{} has too many faces", input_path.string());
+        return false;
+    }
+    input.adviseSequential();
+
+    std::optional<TaskScheduler> scheduler;
+    makeScheduler(scheduler, options);
+    UnwrapContext context{ .options = &options, .scheduler = &*scheduler };
+    std::optional<MemoryTracker> memory_tracker;
+    std::pmr::memory_resource* resource = allocation::defaultResource();
+    std::optional<xatlas::AllocCallbacks> xatlas_callbacks;
+    if (options.track_memory)
+    {
+        memory_tracker.emplace(resource);
+        resource = &*memory_tracker;
+        xatlas_callbacks = xatlas::AllocCallbacks{ .realloc = &MemoryTracker::reallocate, .free = &MemoryTracker::release, .userData = &*memory_tracker };
+        context.memory_tracker = &*memory_tracker;
+    }
+    const ScopedXatlasAlloc xatlas_alloc(xatlas_callbacks);
+
+    // The budget sets the number of faces streamed at once, sampled to calculate the projection normals, and unwrapped at once
+    const size_t chunk_faces = std::clamp(memory_budget / 8 / sizeof(ChunkFace), min_chunk_faces, max_chunk_faces);
+    const size_t sampled_faces_count = std::max(memory_budget / 4 / (sizeof(FaceData) + sizeof(const FaceData*)), min_chunk_faces);
+    const size_t batch_max_faces = std::max(memory_budget / batch_bytes_per_face, min_chunk_faces);
+    const size_t sample_stride = std::max((faces.size() + sampled_faces_count - 1) / sampled_faces_count, size_t(1));
+
+    // First pass on the faces: check them, sample their normals and sum their area
+    if (! context.enterStage(UnwrapStage::FacesData))
+    {
+        return false;
+    }
+    std::pmr::vector<FaceData> sampled_faces(resource);
+    double mesh_area = 0.0;
+    bool valid_indices = true;
+    std::pmr::vector<double> tasks_area(resource);
+    std::pmr::vector<uint8_t> tasks_valid(resource);
+    const bool sampled = forEachChunk(
+        context,
+        UnwrapStage::FacesData,
+        faces.size(),
+        chunk_faces,
+        [&](size_t chunk_begin, size_t chunk_end)
+        {
+            // Areas are summed per range of faces, then in the ranges order, so that the sum doesn't depend on the threads
+            const size_t tasks_count = (chunk_end - chunk_begin + min_chunk_faces - 1) / min_chunk_faces;
+            tasks_area.assign(tasks_count, 0.0);
+            tasks_valid.assign(tasks_count, 1);
+            scheduler->parallelFor(
+                chunk_end - chunk_begin,
+                min_chunk_faces,
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t index = begin; index < end; ++index)
+                    {
+                        const size_t task = index / min_chunk_faces;
+                        const Face& face = faces[chunk_begin + index];
+                        if (face.i1 >= vertices.size() || face.i2 >= vertices.size() || face.i3 >= vertices.size())
+                        {
+                            tasks_valid[task] = 0;
+                            continue;
+                        }
+                        const Vector edge1(vertices[face.i1], vertices[face.i2]);
+                        const Vector edge2(vertices[face.i1], vertices[face.i3]);
+                        tasks_area[task] += edge1.cross(edge2).length() / 2.0;
+                    }
+                });
+            mesh_area = std::accumulate(tasks_area.begin(), tasks_area.end(), mesh_area);
+            valid_indices = valid_indices && std::all_of(tasks_valid.begin(), tasks_valid.end(), [](uint8_t valid) { return valid != 0; });
+            if (! valid_indices)
+            {
+                return;
+            }
+
+            for (size_t index = (chunk_begin + sample_stride - 1) / sample_stride * sample_stride; index < chunk_end; index += sample_stride)
+            {
+                const Face& face = faces[index];
+                if (const std::optional<Vector> normal = geometry_utils::triangleNormal(vertices[face.i1], vertices[face.i2], vertices[face.i3]))
+                {
+                    sampled_faces.push_back(FaceData{ .face = nullptr, .face_index = index, .normal = *normal });
+                }
+            }
+        });
+    if (! sampled)
+    {
+        return false;
+    }
+    if (! valid_indices)
+    {
+        spdlog::error("{} has faces indexing vertices out of range", input_path.string());
+        return false;
+    }
+
+    if (! context.enterStage(UnwrapStage::ProjectionNormals))
+    {
+        return false;
+    }
+    std::pmr::vector<Vector> projection_normals = calculateProjectionNormals(sampled_faces, options.angle_limit, *scheduler, resource);
+    sampled_faces = std::pmr::vector<FaceData>(resource);
+
+    // Second pass on the faces: assign them to the closest projection normal, and spill them to the file of the normal. Faces too far from all the
+    // sampled normals get their own normal, in the faces order.
+    if (! context.enterStage(UnwrapStage::Clustering))
+    {
+        return false;
+    }
+    const uint32_t cells_per_axis
+        = std::clamp(static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(faces.size()) / static_cast<double>(batch_max_faces)))), 1U, max_cells_per_axis);
+    const CellGrid grid(vertices, cells_per_axis);
+    std::filesystem::path spill_path = output_path;
+    spill_path += ".spill";
+    const SpillDirectory spill_directory(spill_path);
+    std::vector<std::unique_ptr<SpillFile>> spill_files;
+    const float angle_limit_cos = std::cos(geometry_utils::deg2rad(options.angle_limit));
+    std::pmr::vector<ChunkFace> chunk(resource);
+    const bool clustered = forEachChunk(
+        context,
+        UnwrapStage::Clustering,
+        faces.size(),
+        chunk_faces,
+        [&](size_t chunk_begin, size_t chunk_end)
+        {
+            chunk.resize(chunk_end - chunk_begin);
+            scheduler->parallelFor(
+                chunk.size(),
+                min_chunk_faces,
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t index = begin; index < end; ++index)
+                    {
+                        const Face& face = faces[chunk_begin + index];
+                        const std::optional<Vector> normal = geometry_utils::triangleNormal(vertices[face.i1], vertices[face.i2], vertices[face.i3]);
+                        ChunkFace& chunk_face = chunk[index];
+                        chunk_face.valid = normal.has_value();
+                        if (! normal.has_value())
+                        {
+                            continue;
+                        }
+
+                        chunk_face.normal = *normal;
+                        chunk_face.best_dot = std::numeric_limits<float>::lowest();
+                        for (size_t normal_index = 0; normal_index < projection_normals.size(); ++normal_index)
+                        {
+                            const float dot = normal->dot(projection_normals[normal_index]);
+                            if (dot > chunk_face.best_dot)
+                            {
+                                chunk_face.best_dot = dot;
+                                chunk_face.group = static_cast<uint32_t>(normal_index);
+                            }
+                        }
+                        chunk_face.cell = grid.cell(vertices[face.i1], vertices[face.i2], vertices[face.i3]);
+                    }
+                });
+
+            const size_t chunk_normals_count = projection_normals.size();
+            for (size_t index = 0; index < chunk.size(); ++index)
+            {
+                ChunkFace& chunk_face = chunk[index];
+                if (! chunk_face.valid)
+                {
+                    continue;
+                }
+
+                if (chunk_face.best_dot < angle_limit_cos)
+                {
+                    for (size_t normal_index = chunk_normals_count; normal_index < projection_normals.size(); ++normal_index)
+                    {
+                        const float dot = chunk_face.normal.dot(projection_normals[normal_index]);
+                        if (dot > chunk_face.best_dot)
+                        {
+                            chunk_face.best_dot = dot;
+                            chunk_face.group = static_cast<uint32_t>(normal_index);
+                        }
+                    }
+                    if (chunk_face.best_dot < angle_limit_cos)
+                    {
+                        chunk_face.group = static_cast<uint32_t>(projection_normals.size());
+                        projection_normals.push_back(chunk_face.normal);
+                    }
+                }
+
+                if (chunk_face.group >= spill_files.size())
+                {
+                    spill_files.resize(projection_normals.size());
+                }
+                std::unique_ptr<SpillFile>& spill_file = spill_files[chunk_face.group];
+                if (! spill_file)
+                {
+                    spill_file = std::make_unique<SpillFile>(spill_directory.path() / std::to_string(chunk_face.group), grid.cellsCount());
+                }
+                spill_file->write(SpilledFace{ .face_index = static_cast<uint32_t>(chunk_begin + index), .cell = chunk_face.cell });
+            }
+        });
+    chunk = std::pmr::vector<ChunkFace>(resource);
+    if (! clustered)
+    {
+        return false;
+    }
+
+    // Split the groups into batches of consecutive cells
+    std::vector<Batch> batches;
+    for (size_t group = 0; group < spill_files.size(); ++group)
+    {
+        if (! spill_files[group])
+        {
+            continue;
+        }
+
+        SpillFile& spill_file = *spill_files[group];
+        spill_file.flush();
+        if (! spill_file.good())
+        {
+            spdlog::error("Unable to write the spill files in {}", spill_directory.path().string());
+            return false;
+        }
+        spill_file.prepareReading();
+
+        const std::vector<uint64_t>& cell_faces_count = spill_file.cellFacesCount();
+        uint64_t batch_faces_count = 0;
+        for (uint32_t cell = 0; cell < cell_faces_count.size(); ++cell)
+        {
+            if (cell_faces_count[cell] == 0)
+            {
+                continue;
+            }
+            if (batches.empty() || batches.back().group != group || batch_faces_count + cell_faces_count[cell] > batch_max_faces)
+            {
+                batches.push_back(Batch{ .group = static_cast<uint32_t>(group), .first_cell = cell, .end_cell = cell + 1 });
+                batch_faces_count = 0;
+            }
+            batches.back().end_cell = cell + 1;
+            batch_faces_count += cell_faces_count[cell];
+        }
+    }
+
+    MappedFile output(output_path, raw_files::uvsFileSize(faces.size()));
+    if (output.mutableData() == nullptr)
+    {
+        spdlog::error("Unable to write the UV file {}", output_path.string());
+        return false;
+    }
+    auto* corner_uvs = reinterpret_cast<UVCoord*>(output.mutableData() + sizeof(raw_files::UvsHeader));
+
+    // All the batches are packed with the same texel density, estimated as xatlas does for a whole mesh
+    xatlas::PackOptions pack_options = default_pack_options;
+    const float resolution = static_cast<float>(options.resolution > 0 ? options.resolution : default_pack_options.resolution);
+    pack_options.resolution = 0;
+    pack_options.texelsPerUnit = std::sqrt(resolution * resolution / std::max(static_cast<float>(mesh_area) / 0.75F, 1.0F));
+    pack_options.padding = options.padding;
+    pack_options.bruteForce = options.brute_force;
+    pack_options.seed = options.seed;
+
+    std::pmr::vector<uint32_t> batch_faces(resource);
+    double covered_texels = 0.0;
+    for (Batch& batch : batches)
+    {
+        spill_files[batch.group]->read(batch.first_cell, batch.end_cell, batch_faces);
+        if (! unwrapBatch(context, vertices, faces, batch_faces, projection_normals[batch.group], pack_options, corner_uvs, batch, result, covered_texels, resource))
+        {
+            return false;
+        }
+    }
+
+    // Lay the batches out side by side, then move their UV coordinates to the whole atlas
+    if (! context.enterStage(UnwrapStage::Output))
+    {
+        return false;
+    }
+    const auto [atlas_width, atlas_height] = layOutBatches(batches, std::max(options.padding, 1U));
+    const auto width = static_cast<float>(atlas_width);
+    const auto height = static_cast<float>(atlas_height);
+    for (const auto& [index, batch] : batches | ranges::views::enumerate)
+    {
+        spill_files[batch.group]->read(batch.first_cell, batch.end_cell, batch_faces);
+        for (const uint32_t face_index : batch_faces)
+        {
+            for (UVCoord& uv_coord : std::span(corner_uvs + static_cast<size_t>(face_index) * 3, 3))
+            {
+                uv_coord = UVCoord{ .u = (uv_coord.u + static_cast<float>(batch.x)) / width, .v = (uv_coord.v + static_cast<float>(batch.y)) / height };
+            }
+        }
+        if (! context.reportProgress(UnwrapStage::Output, static_cast<float>(index + 1) / static_cast<float>(batches.size())))
+        {
+            return false;
+        }
+    }
+
+    const uint32_t max_side = std::max(atlas_width, atlas_height);
+    const double scale = static_cast<double>(texture_definition) / static_cast<double>(max_side);
+    result.texture_width = std::llrint(atlas_width * scale);
+    result.texture_height = std::llrint(atlas_height * scale);
+    const raw_files::UvsHeader header{ .texture_width = result.texture_width, .texture_height = result.texture_height, .faces_count = faces.size() };
+    std::memcpy(output.mutableData(), &header, sizeof(header));
+
+    const std::array<uint32_t, 2> texture_size{ result.texture_width, result.texture_height };
+    result.uv_hash = hash_utils::hashBytes(texture_size.data(), sizeof(texture_size), hash_utils::hashBytes(corner_uvs, faces.size() * 3 * sizeof(UVCoord)));
+    result.stats.atlas_width = atlas_width;
+    result.stats.atlas_height = atlas_height;
+    result.stats.utilization = static_cast<float>(covered_texels / (static_cast<double>(atlas_width) * static_cast<double>(atlas_height)));
+    context.leaveStage();
+    result.stats.stage_durations = context.stage_durations;
+    result.stats.workers = scheduler->workerStats();
+    if (memory_tracker.has_value())
+    {
+        result.stats.peak_memory = memory_tracker->peakSize();
+        for (size_t stage = 0; stage < unwrap_stage_count; ++stage)
+        {
+            result.stats.stage_peak_memory[stage] = memory_tracker->stagePeakSize(static_cast<UnwrapStage>(stage));
+        }
+    }
+
+    return true;
+}
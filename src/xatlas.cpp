@@ -34,6 +34,8 @@ MIT License
 Copyright (c) 2012 Brandon Pelfrey
 */
 #include "xatlas.h"
+#include "TaskScheduler.h"
+#include "trace.h"
 #ifndef XATLAS_C_API
 #define XATLAS_C_API 0
 #endif
@@ -42,12 +44,9 @@ Copyright (c) 2012 Brandon Pelfrey
 #endif
 #include <assert.h>
 #include <atomic>
-#include <condition_variable>
 #include <float.h> // FLT_MAX
 #include <limits.h>
 #include <math.h>
-#include <mutex>
-#include <thread>
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
 #include <stdio.h>
@@ -133,15 +132,12 @@ namespace xatlas
 namespace internal
 {
 
-// Custom memory allocation.
-typedef void* (*ReallocFunc)(void*, size_t);
-typedef void (*FreeFunc)(void*);
-
 // Custom print function.
 typedef int (*PrintFunc)(const char*, ...);
 
 static ReallocFunc s_realloc = realloc;
 static FreeFunc s_free = free;
+static thread_local const AllocCallbacks* s_threadAlloc = nullptr; // Overrides s_realloc and s_free for the current thread.
 static PrintFunc s_print = printf;
 static bool s_printVerbose = false;
 
@@ -149,6 +145,18 @@ static void* Realloc(void* ptr, size_t size, const char* /*file*/, int /*line*/)
 {
     if (size == 0 && ! ptr)
         return nullptr;
+    if (s_threadAlloc)
+    {
+        if (size == 0)
+        {
+            if (s_threadAlloc->free)
+                s_threadAlloc->free(s_threadAlloc->userData, ptr);
+            return nullptr;
+        }
+        void* mem = s_threadAlloc->realloc(s_threadAlloc->userData, ptr, size);
+        XA_DEBUG_ASSERT(mem);
+        return mem;
+    }
     if (size == 0 && s_free)
     {
         s_free(ptr);
@@ -900,6 +908,11 @@ public:
         m_wordArray.resize((m_size + 31) >> 5);
     }
 
+    uint32_t size() const
+    {
+        return m_size;
+    }
+
     bool get(uint32_t index) const
     {
         XA_DEBUG_ASSERT(index < m_size);
@@ -1021,6 +1034,7 @@ public:
 
     bool canBlit(const BitImage& image, uint32_t offsetX, uint32_t offsetY) const
     {
+        UVULA_TRACE_TOTAL("canBlit");
         for (uint32_t y = 0; y < image.m_height; y++)
         {
             const uint32_t thisY = y + offsetY;
@@ -1048,6 +1062,7 @@ public:
 
     void dilate(uint32_t padding)
     {
+        UVULA_TRACE_ZONE("dilate");
         BitImage tmp(m_width, m_height);
         for (uint32_t p = 0; p < padding; p++)
         {
@@ -1095,6 +1110,77 @@ private:
     Array<uint64_t> m_data;
 };
 
+// The charts packed in an atlas, as the index of the chart covering each texel and the flags of the texel.
+class AtlasImage
+{
+public:
+    AtlasImage(uint32_t width, uint32_t height)
+        : m_width(width)
+        , m_height(height)
+    {
+        m_data.resize(m_width * m_height);
+        m_data.zeroOutMemory();
+    }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        Array<uint32_t> data;
+        data.resize(width * height);
+        data.zeroOutMemory();
+        for (uint32_t y = 0; y < min(m_height, height); y++)
+            memcpy(&data[y * width], &m_data[y * m_width], min(m_width, width) * sizeof(uint32_t));
+        m_width = width;
+        m_height = height;
+        data.moveTo(m_data);
+    }
+
+    void addChart(uint32_t chartIndex, const BitImage* image, const BitImage* imageBilinear, const BitImage* imagePadding, int atlas_w, int atlas_h, int offset_x, int offset_y)
+    {
+        const int w = image->width();
+        const int h = image->height();
+        for (int y = 0; y < h; y++)
+        {
+            const int yy = y + offset_y;
+            if (yy < 0 || yy >= atlas_h)
+                continue;
+            for (int x = 0; x < w; x++)
+            {
+                const int xx = x + offset_x;
+                if (xx < 0 || xx >= atlas_w)
+                    continue;
+                uint32_t& texel = m_data[xx + yy * m_width];
+                if (image->get(x, y))
+                {
+                    XA_DEBUG_ASSERT(texel == 0);
+                    texel = chartIndex | kImageHasChartIndexBit;
+                }
+                else if (imageBilinear && imageBilinear->get(x, y))
+                {
+                    XA_DEBUG_ASSERT(texel == 0);
+                    texel = chartIndex | kImageHasChartIndexBit | kImageIsBilinearBit;
+                }
+                else if (imagePadding && imagePadding->get(x, y))
+                {
+                    XA_DEBUG_ASSERT(texel == 0);
+                    texel = chartIndex | kImageHasChartIndexBit | kImageIsPaddingBit;
+                }
+            }
+        }
+    }
+
+    // Copies the image without the padding of the outer edges.
+    void copyTo(uint32_t* dest, uint32_t destWidth, uint32_t destHeight, int padding) const
+    {
+        for (uint32_t y = 0; y < destHeight; y++)
+            memcpy(&dest[y * destWidth], &m_data[padding + (y + padding) * m_width], destWidth * sizeof(uint32_t));
+    }
+
+private:
+    uint32_t m_width;
+    uint32_t m_height;
+    Array<uint32_t> m_data;
+};
+
 static uint32_t sdbmHash(const void* data_in, uint32_t size, uint32_t h = 5381)
 {
     const uint8_t* data = (const uint8_t*)data_in;
@@ -1256,10 +1342,13 @@ public:
         reset();
     }
 
-    void reset()
+    // The default seed 0 gives the original KISS state.
+    void reset(uint32_t seed = 0)
     {
-        x = 123456789;
-        y = 362436000;
+        x = 123456789 + seed;
+        y = 362436000 ^ (seed * 2654435769u);
+        if (y == 0)
+            y = 362436000; // The xorshift generator would be stuck at 0.
         z = 521288629;
         c = 7654321;
     }
@@ -1646,23 +1735,6 @@ static uint32_t meshEdgeIndex1(uint32_t edge)
     return faceFirstEdge + (edge - faceFirstEdge + 1) % 3;
 }
 
-struct Spinlock
-{
-    void lock()
-    {
-        while (m_lock.test_and_set(std::memory_order_acquire))
-        {
-        }
-    }
-    void unlock()
-    {
-        m_lock.clear(std::memory_order_release);
-    }
-
-private:
-    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
-};
-
 struct TaskGroupHandle
 {
     uint32_t value = UINT32_MAX;
@@ -1675,55 +1747,44 @@ struct Task
 };
 
 #if XA_MULTITHREADED
+// Task groups on top of the work-stealing scheduler, which is either shared with the caller or owned. The allocation callbacks of the thread creating a
+// group are applied to the threads running its tasks.
 class TaskScheduler
 {
 public:
-    TaskScheduler()
-        : m_shutdown(false)
+    explicit TaskScheduler(::TaskScheduler* scheduler = nullptr)
+        : m_scheduler(scheduler)
+        , m_ownsScheduler(! scheduler)
     {
-        m_threadIndex = 0;
+        if (m_ownsScheduler)
+            m_scheduler = XA_NEW(::TaskScheduler);
         // Max with current task scheduler usage is 1 per thread + 1 deep nesting, but allow for some slop.
-        m_maxGroups = std::thread::hardware_concurrency() * 4;
+        m_maxGroups = m_scheduler->threadCount() * 4;
         m_groups = XA_ALLOC_ARRAY(TaskGroup, m_maxGroups);
         for (uint32_t i = 0; i < m_maxGroups; i++)
         {
             new (&m_groups[i]) TaskGroup();
             m_groups[i].free = true;
-            m_groups[i].ref = 0;
             m_groups[i].userData = nullptr;
-        }
-        m_workers.resize(std::thread::hardware_concurrency() <= 1 ? 1 : std::thread::hardware_concurrency() - 1);
-        for (uint32_t i = 0; i < m_workers.size(); i++)
-        {
-            new (&m_workers[i]) Worker();
-            m_workers[i].wakeup = false;
-            m_workers[i].thread = XA_NEW_ARGS(std::thread, workerThread, this, &m_workers[i], i + 1);
+            m_groups[i].alloc = nullptr;
         }
     }
 
     ~TaskScheduler()
     {
-        m_shutdown = true;
-        for (uint32_t i = 0; i < m_workers.size(); i++)
-        {
-            Worker& worker = m_workers[i];
-            XA_DEBUG_ASSERT(worker.thread);
-            worker.wakeup = true;
-            worker.cv.notify_one();
-            if (worker.thread->joinable())
-                worker.thread->join();
-            worker.thread->~thread();
-            XA_FREE(worker.thread);
-            worker.~Worker();
-        }
         for (uint32_t i = 0; i < m_maxGroups; i++)
             m_groups[i].~TaskGroup();
         XA_FREE(m_groups);
+        if (m_ownsScheduler)
+        {
+            m_scheduler->~TaskScheduler();
+            XA_FREE(m_scheduler);
+        }
     }
 
     uint32_t threadCount() const
     {
-        return max(1u, std::thread::hardware_concurrency()); // Including the main thread.
+        return m_scheduler->threadCount(); // Including the main thread.
     }
 
     // userData is passed to Task::func as groupUserData.
@@ -1736,13 +1797,10 @@ public:
             bool expected = true;
             if (! group.free.compare_exchange_strong(expected, false))
                 continue;
-            group.queueLock.lock();
-            group.queueHead = 0;
-            group.queue.clear();
-            group.queue.reserve(reserveSize);
-            group.queueLock.unlock();
+            group.tasks.clear();
+            group.tasks.reserve(reserveSize);
             group.userData = userData;
-            group.ref = 0;
+            group.alloc = s_threadAlloc;
             TaskGroupHandle handle;
             handle.value = i;
             return handle;
@@ -1757,16 +1815,14 @@ public:
     {
         XA_DEBUG_ASSERT(handle.value != UINT32_MAX);
         TaskGroup& group = m_groups[handle.value];
-        group.queueLock.lock();
-        group.queue.push_back(task);
-        group.queueLock.unlock();
-        group.ref++;
-        // Wake up a worker to run this task.
-        for (uint32_t i = 0; i < m_workers.size(); i++)
-        {
-            m_workers[i].wakeup = true;
-            m_workers[i].cv.notify_one();
-        }
+        // The scheduler keeps a pointer to the task, so it is allocated separately to stay valid when the array grows.
+        GroupTask* groupTask = XA_NEW(GroupTask);
+        groupTask->task = task;
+        groupTask->group = &group;
+        groupTask->schedulerTask.function = runGroupTask;
+        groupTask->schedulerTask.user_data = groupTask;
+        group.tasks.push_back(groupTask);
+        m_scheduler->run(group.schedulerGroup, groupTask->schedulerTask);
     }
 
     void wait(TaskGroupHandle* handle)
@@ -1776,105 +1832,64 @@ public:
             XA_DEBUG_ASSERT(false);
             return;
         }
-        // Run tasks from the group queue until empty.
         TaskGroup& group = m_groups[handle->value];
-        for (;;)
+        m_scheduler->wait(group.schedulerGroup);
+        for (uint32_t i = 0; i < group.tasks.size(); i++)
         {
-            Task* task = nullptr;
-            group.queueLock.lock();
-            if (group.queueHead < group.queue.size())
-                task = &group.queue[group.queueHead++];
-            group.queueLock.unlock();
-            if (! task)
-                break;
-            task->func(group.userData, task->userData);
-            group.ref--;
+            group.tasks[i]->~GroupTask();
+            XA_FREE(group.tasks[i]);
         }
-        // Even though the task queue is empty, workers can still be running tasks.
-        while (group.ref > 0)
-            std::this_thread::yield();
+        group.tasks.clear();
         group.free = true;
         handle->value = UINT32_MAX;
     }
 
     static uint32_t currentThreadIndex()
     {
-        return m_threadIndex;
+        return ::TaskScheduler::currentThreadIndex();
     }
 
 private:
+    struct GroupTask;
+
     struct TaskGroup
     {
         std::atomic<bool> free;
-        Array<Task> queue; // Items are never removed. queueHead is incremented to pop items.
-        uint32_t queueHead = 0;
-        Spinlock queueLock;
-        std::atomic<uint32_t> ref; // Increment when a task is enqueued, decrement when a task finishes.
+        ::TaskScheduler::TaskGroup schedulerGroup;
+        Array<GroupTask*> tasks;
         void* userData;
+        const AllocCallbacks* alloc; // Allocation override of the thread that created the group, applied to the threads running its tasks.
     };
 
-    struct Worker
+    struct GroupTask
     {
-        std::thread* thread = nullptr;
-        std::mutex mutex;
-        std::condition_variable cv;
-        std::atomic<bool> wakeup;
+        ::TaskScheduler::Task schedulerTask;
+        Task task;
+        TaskGroup* group;
     };
 
+    ::TaskScheduler* m_scheduler;
+    bool m_ownsScheduler;
     TaskGroup* m_groups;
-    Array<Worker> m_workers;
-    std::atomic<bool> m_shutdown;
     uint32_t m_maxGroups;
-    static thread_local uint32_t m_threadIndex;
 
-    static void workerThread(TaskScheduler* scheduler, Worker* worker, uint32_t threadIndex)
+    static void runGroupTask(void* userData)
     {
-        m_threadIndex = threadIndex;
-        std::unique_lock<std::mutex> lock(worker->mutex);
-        for (;;)
-        {
-            worker->cv.wait(
-                lock,
-                [=]
-                {
-                    return worker->wakeup.load();
-                });
-            worker->wakeup = false;
-            for (;;)
-            {
-                if (scheduler->m_shutdown)
-                    return;
-                // Look for a task in any of the groups and run it.
-                TaskGroup* group = nullptr;
-                Task* task = nullptr;
-                for (uint32_t i = 0; i < scheduler->m_maxGroups; i++)
-                {
-                    group = &scheduler->m_groups[i];
-                    if (group->free || group->ref == 0)
-                        continue;
-                    group->queueLock.lock();
-                    if (group->queueHead < group->queue.size())
-                    {
-                        task = &group->queue[group->queueHead++];
-                        group->queueLock.unlock();
-                        break;
-                    }
-                    group->queueLock.unlock();
-                }
-                if (! task)
-                    break;
-                task->func(group->userData, task->userData);
-                group->ref--;
-            }
-        }
+        const GroupTask* groupTask = (const GroupTask*)userData;
+        const AllocCallbacks* previousAlloc = s_threadAlloc;
+        s_threadAlloc = groupTask->group->alloc;
+        groupTask->task.func(groupTask->group->userData, groupTask->task.userData);
+        s_threadAlloc = previousAlloc;
     }
 };
-
-thread_local uint32_t TaskScheduler::m_threadIndex;
 #else
 class TaskScheduler
 {
 public:
+    explicit TaskScheduler(::TaskScheduler* /*scheduler*/ = nullptr)
+    {
+    }
+
     ~TaskScheduler()
     {
         for (uint32_t i = 0; i < m_groups.size(); i++)
@@ -1888,7 +1903,7 @@ public:
 
     TaskGroupHandle createTaskGroup(void* userData = nullptr, uint32_t reserveSize = 0)
     {
-        TaskGroup* group = XA_NEW(MemTag::Default, TaskGroup);
+        TaskGroup* group = XA_NEW(TaskGroup);
         group->queue.reserve(reserveSize);
         group->userData = userData;
         m_groups.push_back(group);
@@ -1944,41 +1959,44 @@ private:
 };
 #endif
 
+// The instances are created on first use by the thread owning them, so that their memory is first touched, and placed, on the NUMA node of that thread.
 template<typename T>
 class ThreadLocal
 {
 public:
-    ThreadLocal()
+    explicit ThreadLocal(const TaskScheduler* taskScheduler)
+        : m_count(taskScheduler->threadCount())
     {
-#if XA_MULTITHREADED
-        const uint32_t n = std::thread::hardware_concurrency();
-#else
-        const uint32_t n = 1;
-#endif
-        m_array = XA_ALLOC_ARRAY(T, n);
-        for (uint32_t i = 0; i < n; i++)
-            new (&m_array[i]) T;
+        m_array = XA_ALLOC_ARRAY(T*, m_count);
+        for (uint32_t i = 0; i < m_count; i++)
+            m_array[i] = nullptr;
     }
 
     ~ThreadLocal()
     {
-#if XA_MULTITHREADED
-        const uint32_t n = std::thread::hardware_concurrency();
-#else
-        const uint32_t n = 1;
-#endif
-        for (uint32_t i = 0; i < n; i++)
-            m_array[i].~T();
+        for (uint32_t i = 0; i < m_count; i++)
+        {
+            if (m_array[i])
+            {
+                m_array[i]->~T();
+                XA_FREE(m_array[i]);
+            }
+        }
         XA_FREE(m_array);
     }
 
     T& get() const
     {
-        return m_array[TaskScheduler::currentThreadIndex()];
+        const uint32_t index = TaskScheduler::currentThreadIndex();
+        XA_DEBUG_ASSERT(index < m_count);
+        if (! m_array[index])
+            m_array[index] = XA_NEW(T);
+        return *m_array[index];
     }
 
 private:
-    T* m_array;
+    T** m_array;
+    uint32_t m_count;
 };
 
 class UniformGrid2
@@ -2312,7 +2330,10 @@ struct UvMesh
     Array<Vector2>
         texcoords; // Copied from input and never modified, UvMeshInstance::texcoords are. Used to restore UvMeshInstance::texcoords so packing can be run multiple times.
     Array<UvMeshChart*> charts;
-    Array<uint32_t> vertexToChartMap;
+    // Vertices shared by several charts are split, so that each chart owns its vertices. The first texcoords.size() split vertices are the input vertices.
+    Array<uint32_t> splitIndices; // Same as indices, but referencing split vertices.
+    Array<uint32_t> splitVertexXref; // Input vertex of each split vertex.
+    Array<uint32_t> vertexToChartMap; // Chart of each split vertex.
 };
 
 struct UvMeshInstance
@@ -2600,8 +2621,10 @@ static bool drawTriangle(const Vector2& extents, const Vector2 v[3], SamplingCal
 namespace segment
 {
 
-// - Insertion is o(n)
-// - Smallest element goes at the end, so that popping it is o(1).
+// Min-max heap of (cost, face) pairs.
+// - Insertion and popping the smallest element are o(log n).
+// - When a maximum size is given, the largest element is evicted when the queue overflows, also in o(log n).
+// Even levels of the tree are ordered by smallest cost, odd levels by largest cost.
 struct CostQueue
 {
     CostQueue(uint32_t size = UINT32_MAX)
@@ -2612,39 +2635,30 @@ struct CostQueue
 
     float peekCost() const
     {
-        return m_pairs.back().cost;
+        XA_DEBUG_ASSERT(! m_pairs.isEmpty());
+        return m_pairs[0].cost;
     }
 
     uint32_t peekFace() const
     {
-        return m_pairs.back().face;
+        XA_DEBUG_ASSERT(! m_pairs.isEmpty());
+        return m_pairs[0].face;
     }
 
     void push(float cost, uint32_t face)
     {
         const Pair p = { cost, face };
-        if (m_pairs.isEmpty() || cost < peekCost())
-            m_pairs.push_back(p);
-        else
-        {
-            uint32_t i = 0;
-            const uint32_t count = m_pairs.size();
-            for (; i < count; i++)
-            {
-                if (m_pairs[i].cost < cost)
-                    break;
-            }
-            m_pairs.insertAt(i, p);
-            if (m_pairs.size() > m_maxSize)
-                m_pairs.removeAt(0);
-        }
+        m_pairs.push_back(p);
+        pushUp(m_pairs.size() - 1);
+        if (m_pairs.size() > m_maxSize)
+            removeAt(maxIndex());
     }
 
     uint32_t pop()
     {
         XA_DEBUG_ASSERT(! m_pairs.isEmpty());
-        uint32_t f = m_pairs.back().face;
-        m_pairs.pop_back();
+        const uint32_t f = m_pairs[0].face;
+        removeAt(0);
         return f;
     }
 
@@ -2659,21 +2673,137 @@ struct CostQueue
     }
 
 private:
-    const uint32_t m_maxSize;
-
     struct Pair
     {
         float cost;
         uint32_t face;
     };
 
+    static bool isMinLevel(uint32_t index)
+    {
+        uint32_t level = 0;
+        for (index++; index > 1; index >>= 1)
+            level++;
+        return (level & 1) == 0;
+    }
+
+    static XA_INLINE uint32_t parent(uint32_t index)
+    {
+        return (index - 1) / 2;
+    }
+
+    XA_INLINE bool less(uint32_t a, uint32_t b) const
+    {
+        return m_pairs[a].cost < m_pairs[b].cost;
+    }
+
+    uint32_t maxIndex() const
+    {
+        const uint32_t count = m_pairs.size();
+        if (count <= 2)
+            return count - 1;
+        return less(1, 2) ? 2 : 1;
+    }
+
+    void removeAt(uint32_t index)
+    {
+        const uint32_t last = m_pairs.size() - 1;
+        if (index != last)
+            m_pairs[index] = m_pairs[last];
+        m_pairs.pop_back();
+        // Only used to remove the smallest or largest element, so the moved element can't be out of order with its ancestors.
+        if (index < m_pairs.size())
+            pushDown(index);
+    }
+
+    void pushUp(uint32_t index)
+    {
+        if (index == 0)
+            return;
+        const uint32_t p = parent(index);
+        if (isMinLevel(index))
+        {
+            if (less(p, index))
+            {
+                swap(m_pairs[index], m_pairs[p]);
+                pushUpLevel<true>(p);
+            }
+            else
+                pushUpLevel<false>(index);
+        }
+        else
+        {
+            if (less(index, p))
+            {
+                swap(m_pairs[index], m_pairs[p]);
+                pushUpLevel<false>(p);
+            }
+            else
+                pushUpLevel<true>(index);
+        }
+    }
+
+    // Move the element up through its grand parents, which are on the same kind of level.
+    template<bool MaxLevel>
+    void pushUpLevel(uint32_t index)
+    {
+        while (index > 2)
+        {
+            const uint32_t grandParent = parent(parent(index));
+            if (MaxLevel ? ! less(grandParent, index) : ! less(index, grandParent))
+                break;
+            swap(m_pairs[index], m_pairs[grandParent]);
+            index = grandParent;
+        }
+    }
+
+    void pushDown(uint32_t index)
+    {
+        if (isMinLevel(index))
+            pushDownLevel<false>(index);
+        else
+            pushDownLevel<true>(index);
+    }
+
+    template<bool MaxLevel>
+    void pushDownLevel(uint32_t index)
+    {
+        const uint32_t count = m_pairs.size();
+        for (;;)
+        {
+            const uint32_t firstChild = index * 2 + 1;
+            if (firstChild >= count)
+                return;
+            // Find the smallest (or largest) of the children and grand children.
+            uint32_t best = firstChild;
+            const uint32_t candidates[5] = { firstChild + 1, firstChild * 2 + 1, firstChild * 2 + 2, firstChild * 2 + 3, firstChild * 2 + 4 };
+            for (uint32_t i = 0; i < 5 && candidates[i] < count; i++)
+            {
+                if (MaxLevel ? less(best, candidates[i]) : less(candidates[i], best))
+                    best = candidates[i];
+            }
+            if (MaxLevel ? ! less(index, best) : ! less(best, index))
+                return;
+            swap(m_pairs[index], m_pairs[best]);
+            if (best <= firstChild + 1)
+                return; // Best was a child, the grand children are still ordered.
+            // Best was a grand child, it may now be out of order with its parent, which is on the other kind of level.
+            const uint32_t p = parent(best);
+            if (MaxLevel ? less(best, p) : less(p, best))
+                swap(m_pairs[best], m_pairs[p]);
+            index = best;
+        }
+    }
+
+    const uint32_t m_maxSize;
     Array<Pair> m_pairs;
 };
 
-// Charts are found by floodfilling faces without crossing UV seams.
+// Charts are given by the caller as groups of faces. A face can only belong to one chart, but a vertex shared by faces of different charts
+// (a seam vertex) is split into one vertex per chart. Runs in linear time of the number of grouped faces.
 struct SetUvMeshChartsTask
 {
-    SetUvMeshChartsTask(UvMesh* const mesh, const std::vector<std::vector<size_t>>& grouped_faces)
+    SetUvMeshChartsTask(UvMesh* const mesh, const std::pmr::vector<std::pmr::vector<size_t>>& grouped_faces)
         : m_mesh(mesh)
         , m_grouped_faces(grouped_faces)
         , m_faceAssigned(m_mesh->indices.size() / 3)
@@ -2686,13 +2816,29 @@ struct SetUvMeshChartsTask
         const uint32_t indexCount = m_mesh->indices.size();
         const uint32_t faceCount = indexCount / 3;
 
-        // A vertex can only be assigned to one chart.
+        // Charts may have been set before.
+        for (uint32_t i = 0; i < m_mesh->charts.size(); i++)
+        {
+            m_mesh->charts[i]->~UvMeshChart();
+            XA_FREE(m_mesh->charts[i]);
+        }
+        m_mesh->charts.clear();
+
+        // Until a vertex is shared by several charts, split vertices are the input vertices.
         m_mesh->vertexToChartMap.resize(vertexCount);
         m_mesh->vertexToChartMap.fill(UINT32_MAX);
+        m_mesh->splitVertexXref.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++)
+            m_mesh->splitVertexXref[i] = i;
+        m_mesh->splitIndices.resize(indexCount);
+        memcpy(m_mesh->splitIndices.data(), m_mesh->indices.data(), indexCount * sizeof(uint32_t));
+        m_splitVertexChart.resize(vertexCount);
+        m_splitVertexChart.fill(UINT32_MAX);
+        m_splitVertex.resize(vertexCount);
 
         // Assign charts
         m_faceAssigned.zeroOutMemory();
-        for (const std::vector<size_t>& face_group : m_grouped_faces)
+        for (const std::pmr::vector<size_t>& face_group : m_grouped_faces)
         {
             const uint32_t chartIndex = m_mesh->charts.size();
             UvMeshChart* chart = XA_NEW(UvMeshChart);
@@ -2701,11 +2847,19 @@ struct SetUvMeshChartsTask
 
             for (const size_t face_index : face_group)
             {
-                if (canAddFaceToChart(chartIndex, face_index))
+                if (face_index < faceCount && canAddFaceToChart(chartIndex, (uint32_t)face_index))
                 {
-                    addFaceToChart(chartIndex, face_index);
+                    addFaceToChart(chartIndex, (uint32_t)face_index);
                 }
             }
+
+            if (chart->faces.isEmpty())
+            {
+                // All the faces of the group were ignored or already assigned, don't keep an empty chart.
+                chart->~UvMeshChart();
+                XA_FREE(chart);
+                m_mesh->charts.pop_back();
+            }
         }
     }
 
@@ -2722,12 +2876,6 @@ private:
             if (m_mesh->faceMaterials[face] != m_mesh->charts[chartIndex]->material)
                 return false; // Materials don't match.
         }
-        for (uint32_t i = 0; i < 3; i++)
-        {
-            const uint32_t vertex = m_mesh->indices[face * 3 + i];
-            if (m_mesh->vertexToChartMap[vertex] != UINT32_MAX && m_mesh->vertexToChartMap[vertex] != chartIndex)
-                return false; // Vertex already assigned to another chart.
-        }
         return true;
     }
 
@@ -2739,14 +2887,32 @@ private:
         for (uint32_t i = 0; i < 3; i++)
         {
             const uint32_t vertex = m_mesh->indices[face * 3 + i];
-            m_mesh->vertexToChartMap[vertex] = chartIndex;
-            chart->indices.push_back(vertex);
+            uint32_t splitVertex = vertex;
+            const uint32_t vertexChart = m_mesh->vertexToChartMap[vertex];
+            if (vertexChart == UINT32_MAX)
+                m_mesh->vertexToChartMap[vertex] = chartIndex;
+            else if (vertexChart != chartIndex)
+            {
+                // Seam vertex, use the copy owned by this chart. Faces of a chart are added consecutively, so remembering the last chart is enough.
+                if (m_splitVertexChart[vertex] != chartIndex)
+                {
+                    m_splitVertexChart[vertex] = chartIndex;
+                    m_splitVertex[vertex] = m_mesh->splitVertexXref.size();
+                    m_mesh->splitVertexXref.push_back(vertex);
+                    m_mesh->vertexToChartMap.push_back(chartIndex);
+                }
+                splitVertex = m_splitVertex[vertex];
+            }
+            m_mesh->splitIndices[face * 3 + i] = splitVertex;
+            chart->indices.push_back(splitVertex);
         }
     }
 
     UvMesh* const m_mesh;
-    const std::vector<std::vector<size_t>>& m_grouped_faces;
+    const std::pmr::vector<std::pmr::vector<size_t>>& m_grouped_faces;
     BitArray m_faceAssigned;
+    Array<uint32_t> m_splitVertexChart; // Per input vertex, last chart a split vertex was created for.
+    Array<uint32_t> m_splitVertex; // Per input vertex, split vertex created for m_splitVertexChart.
 };
 
 } // namespace segment
@@ -2757,6 +2923,7 @@ namespace pack
 struct Chart
 {
     int32_t atlasIndex;
+    bool rotated; // Rotated by 90 degrees when placed.
     uint32_t material;
     ConstArrayView<uint32_t> indices;
     float parametricArea;
@@ -2794,6 +2961,11 @@ struct Atlas
             m_charts[i]->~Chart();
             XA_FREE(m_charts[i]);
         }
+        for (uint32_t i = 0; i < m_atlasImages.size(); i++)
+        {
+            m_atlasImages[i]->~AtlasImage();
+            XA_FREE(m_atlasImages[i]);
+        }
     }
 
     uint32_t getWidth() const
@@ -2824,78 +2996,53 @@ struct Atlas
     {
         return m_utilization[atlas];
     }
+    const AtlasImage* getImage(uint32_t atlas) const
+    {
+        return m_atlasImages[atlas];
+    }
 
-    void addUvMeshCharts(UvMeshInstance* mesh)
+    void addUvMeshCharts(UvMeshInstance* mesh, TaskScheduler* taskScheduler)
     {
-        // Copy texcoords from mesh.
-        mesh->texcoords.resize(mesh->mesh->texcoords.size());
-        memcpy(mesh->texcoords.data(), mesh->mesh->texcoords.data(), mesh->texcoords.size() * sizeof(Vector2));
-        BitArray vertexUsed(mesh->texcoords.size());
-        BoundingBox2D boundingBox;
-        for (uint32_t c = 0; c < mesh->mesh->charts.size(); c++)
+        // Copy texcoords from mesh, seam vertices get the texcoords of the vertex they were split from.
+        const uint32_t inputVertexCount = mesh->mesh->texcoords.size();
+        const uint32_t splitVertexCount = mesh->mesh->splitVertexXref.size();
+        mesh->texcoords.resize(splitVertexCount);
+        memcpy(mesh->texcoords.data(), mesh->mesh->texcoords.data(), inputVertexCount * sizeof(Vector2));
+        for (uint32_t v = inputVertexCount; v < splitVertexCount; v++)
+            mesh->texcoords[v] = mesh->mesh->texcoords[mesh->mesh->splitVertexXref[v]];
+        const uint32_t chartCount = mesh->mesh->charts.size();
+        if (chartCount == 0)
+            return;
+        // Charts are independent from each other, preprocess them in parallel. Each task writes to its own slots of m_charts so the chart order is preserved.
+        const uint32_t chartOffset = m_charts.size();
+        m_charts.resize(chartOffset + chartCount);
+        // Batch charts so that meshes with a lot of small charts don't flood the scheduler with tiny tasks.
+        const uint32_t chartsPerTask = max(1u, chartCount / (taskScheduler->threadCount() * 4));
+        const uint32_t taskCount = (chartCount + chartsPerTask - 1) / chartsPerTask;
+        ThreadLocal<BoundingBox2D> boundingBox(taskScheduler);
+        ThreadLocal<BitArray> vertexUsed(taskScheduler);
+        Array<AddUvMeshChartsTaskArgs> taskArgs;
+        taskArgs.resize(taskCount);
+        TaskGroupHandle taskGroup = taskScheduler->createTaskGroup(nullptr, taskCount);
+        for (uint32_t t = 0; t < taskCount; t++)
         {
-            UvMeshChart* uvChart = mesh->mesh->charts[c];
-            Chart* chart = XA_NEW(Chart);
-            chart->atlasIndex = -1;
-            chart->material = uvChart->material;
-            chart->indices = uvChart->indices;
-            chart->vertices = mesh->texcoords;
-            chart->boundaryEdges = nullptr;
-            chart->faces.resize(uvChart->faces.size());
-            memcpy(chart->faces.data(), uvChart->faces.data(), sizeof(uint32_t) * uvChart->faces.size());
-            // Find unique vertices.
-            vertexUsed.zeroOutMemory();
-            for (uint32_t i = 0; i < chart->indices.length; i++)
-            {
-                const uint32_t vertex = chart->indices[i];
-                if (! vertexUsed.get(vertex))
-                {
-                    vertexUsed.set(vertex);
-                    chart->uniqueVertices.push_back(vertex);
-                }
-            }
-            // Compute parametric and surface areas.
-            chart->parametricArea = 0.0f;
-            for (uint32_t f = 0; f < chart->indices.length / 3; f++)
-            {
-                const Vector2& v1 = chart->vertices[chart->indices[f * 3 + 0]];
-                const Vector2& v2 = chart->vertices[chart->indices[f * 3 + 1]];
-                const Vector2& v3 = chart->vertices[chart->indices[f * 3 + 2]];
-                chart->parametricArea += fabsf(triangleArea(v1, v2, v3));
-            }
-            chart->parametricArea *= 0.5f;
-            if (chart->parametricArea < kAreaEpsilon)
-            {
-                // When the parametric area is too small we use a rough approximation to prevent divisions by very small numbers.
-                Vector2 minCorner(FLT_MAX, FLT_MAX);
-                Vector2 maxCorner(-FLT_MAX, -FLT_MAX);
-                for (uint32_t v = 0; v < chart->uniqueVertexCount(); v++)
-                {
-                    minCorner = min(minCorner, chart->uniqueVertexAt(v));
-                    maxCorner = max(maxCorner, chart->uniqueVertexAt(v));
-                }
-                const Vector2 bounds = (maxCorner - minCorner) * 0.5f;
-                chart->parametricArea = bounds.x * bounds.y;
-            }
-            XA_DEBUG_ASSERT(isFinite(chart->parametricArea));
-            XA_DEBUG_ASSERT(! isNan(chart->parametricArea));
-            chart->surfaceArea = chart->parametricArea; // Identical for UV meshes.
-            // Compute bounding box of chart.
-            // Using all unique vertices for simplicity, can compute real boundaries if this is too slow.
-            boundingBox.clear();
-            for (uint32_t v = 0; v < chart->uniqueVertexCount(); v++)
-                boundingBox.appendBoundaryVertex(chart->uniqueVertexAt(v));
-            boundingBox.compute();
-            chart->majorAxis = boundingBox.majorAxis;
-            chart->minorAxis = boundingBox.minorAxis;
-            chart->minCorner = boundingBox.minCorner;
-            chart->maxCorner = boundingBox.maxCorner;
-            m_charts.push_back(chart);
+            AddUvMeshChartsTaskArgs& args = taskArgs[t];
+            args.mesh = mesh;
+            args.charts = &m_charts[chartOffset];
+            args.firstChart = t * chartsPerTask;
+            args.lastChart = min(args.firstChart + chartsPerTask, chartCount);
+            args.boundingBox = &boundingBox;
+            args.vertexUsed = &vertexUsed;
+            Task task;
+            task.userData = &args;
+            task.func = runAddUvMeshChartsTask;
+            taskScheduler->run(taskGroup, task);
         }
+        taskScheduler->wait(&taskGroup);
     }
 
     // Pack charts in the smallest possible rectangle.
-    bool packCharts(const PackOptions& options)
+    bool packCharts(const PackOptions& options, ProgressFunc progressFunc, void* progressUserData)
     {
         const uint32_t chartCount = m_charts.size();
         XA_PRINT("Packing %u charts\n", chartCount);
@@ -2903,6 +3050,8 @@ struct Atlas
         {
             return true;
         }
+        // Restart the random placement from the seed, so that packing the same charts with the same options always gives the same result.
+        m_rand.reset(options.seed);
         // Estimate resolution and/or texels per unit if not specified.
         m_texelsPerUnit = options.texelsPerUnit;
         uint32_t resolution = options.resolution > 0 ? options.resolution + options.padding * 2 : 0;
@@ -3051,7 +3200,6 @@ struct Atlas
         UniformGrid2 boundaryEdgeGrid;
         Array<Vector2i> atlasSizes;
         atlasSizes.push_back(Vector2i(0, 0));
-        int progress = 0;
         for (uint32_t i = 0; i < chartCount; i++)
         {
             uint32_t c = ranks[chartCount - i - 1]; // largest chart first
@@ -3069,6 +3217,10 @@ struct Atlas
             //   \ / \ / \ /
             //    V   V   V
             //    0   1   2
+            // The rasterization and placement of the charts alternate, report each of them so that they can be profiled.
+            const int progress = int(i / (float)chartCount * 100.0f);
+            if (progressFunc && ! progressFunc(ProgressCategory::RasterizeCharts, progress, progressUserData))
+                return false;
             // Resize and clear (discard = true) chart images.
             // Leave room for padding at extents.
             chartImage.resize(ftoi_ceil(chartExtents[c].x) + options.padding, ftoi_ceil(chartExtents[c].y) + options.padding, true);
@@ -3113,6 +3265,8 @@ struct Atlas
                     chartImagePaddingRotated.dilate(options.padding);
                 }
             }
+            if (progressFunc && ! progressFunc(ProgressCategory::PlaceCharts, progress, progressUserData))
+                return false;
             // Update brute force bucketing.
             if (options.bruteForce)
             {
@@ -3155,6 +3309,8 @@ struct Atlas
                     // Chart doesn't fit in the current bitImage, create a new one.
                     BitImage* bi = XA_NEW_ARGS(BitImage, resolution, resolution);
                     m_bitImages.push_back(bi);
+                    if (options.createImage)
+                        m_atlasImages.push_back(XA_NEW_ARGS(AtlasImage, resolution, resolution));
                     atlasSizes.push_back(Vector2i(0, 0));
 #if XA_DEBUG
                     firstChartInBitImage = true;
@@ -3214,6 +3370,8 @@ struct Atlas
                 if (w > m_bitImages[0]->width() || h > m_bitImages[0]->height())
                 {
                     m_bitImages[0]->resize(nextPowerOfTwo(w), nextPowerOfTwo(h), false);
+                    if (options.createImage)
+                        m_atlasImages[0]->resize(m_bitImages[0]->width(), m_bitImages[0]->height());
                 }
             }
             else
@@ -3222,7 +3380,31 @@ struct Atlas
                 XA_DEBUG_ASSERT(atlasSizes[currentAtlas].y <= (int)maxResolution);
             }
             addChart(m_bitImages[currentAtlas], chartImageToPack, chartImageToPackRotated, atlasSizes[currentAtlas].x, atlasSizes[currentAtlas].y, best_x, best_y, best_r);
+            if (options.createImage)
+            {
+                if (best_r == 0)
+                    m_atlasImages[currentAtlas]->addChart(
+                        c,
+                        &chartImage,
+                        options.bilinear ? &chartImageBilinear : nullptr,
+                        options.padding > 0 ? &chartImagePadding : nullptr,
+                        atlasSizes[currentAtlas].x,
+                        atlasSizes[currentAtlas].y,
+                        best_x,
+                        best_y);
+                else
+                    m_atlasImages[currentAtlas]->addChart(
+                        c,
+                        &chartImageRotated,
+                        options.bilinear ? &chartImageBilinearRotated : nullptr,
+                        options.padding > 0 ? &chartImagePaddingRotated : nullptr,
+                        atlasSizes[currentAtlas].x,
+                        atlasSizes[currentAtlas].y,
+                        best_x,
+                        best_y);
+            }
             chart->atlasIndex = (int32_t)currentAtlas;
+            chart->rotated = best_r != 0;
             // Modify texture coordinates:
             //  - rotate if the chart should be rotated
             //  - translate to chart location
@@ -3244,6 +3426,7 @@ struct Atlas
                 XA_ASSERT(isFinite(texcoord.x) && isFinite(texcoord.y));
             }
         }
+        UVULA_TRACE_EMIT_TOTAL("canBlit");
         // Remove padding from outer edges.
         if (maxResolution == 0)
         {
@@ -3283,6 +3466,93 @@ struct Atlas
     }
 
 private:
+    struct AddUvMeshChartsTaskArgs
+    {
+        UvMeshInstance* mesh;
+        Chart** charts; // Output, indexed by mesh chart.
+        uint32_t firstChart;
+        uint32_t lastChart; // Exclusive.
+        ThreadLocal<BoundingBox2D>* boundingBox;
+        ThreadLocal<BitArray>* vertexUsed;
+    };
+
+    static void runAddUvMeshChartsTask(void* /*groupUserData*/, void* taskUserData)
+    {
+        auto args = (AddUvMeshChartsTaskArgs*)taskUserData;
+        BitArray& vertexUsed = args->vertexUsed->get();
+        if (vertexUsed.size() < args->mesh->texcoords.size())
+        {
+            vertexUsed.resize(args->mesh->texcoords.size());
+            vertexUsed.zeroOutMemory();
+        }
+        for (uint32_t c = args->firstChart; c < args->lastChart; c++)
+            args->charts[c] = createUvMeshChart(args->mesh, args->mesh->mesh->charts[c], args->boundingBox->get(), vertexUsed);
+    }
+
+    // vertexUsed must be cleared on input, and is left cleared on output.
+    static Chart* createUvMeshChart(UvMeshInstance* mesh, const UvMeshChart* uvChart, BoundingBox2D& boundingBox, BitArray& vertexUsed)
+    {
+        Chart* chart = XA_NEW(Chart);
+        chart->atlasIndex = -1;
+        chart->rotated = false;
+        chart->material = uvChart->material;
+        chart->indices = uvChart->indices;
+        chart->vertices = mesh->texcoords;
+        chart->boundaryEdges = nullptr;
+        chart->faces.resize(uvChart->faces.size());
+        memcpy(chart->faces.data(), uvChart->faces.data(), sizeof(uint32_t) * uvChart->faces.size());
+        // Find unique vertices.
+        for (uint32_t i = 0; i < chart->indices.length; i++)
+        {
+            const uint32_t vertex = chart->indices[i];
+            if (! vertexUsed.get(vertex))
+            {
+                vertexUsed.set(vertex);
+                chart->uniqueVertices.push_back(vertex);
+            }
+        }
+        // Only clear the bits of this chart, the whole mesh bit array is shared by all the charts processed on this thread.
+        for (uint32_t i = 0; i < chart->uniqueVertices.size(); i++)
+            vertexUsed.unset(chart->uniqueVertices[i]);
+        // Compute parametric and surface areas.
+        chart->parametricArea = 0.0f;
+        for (uint32_t f = 0; f < chart->indices.length / 3; f++)
+        {
+            const Vector2& v1 = chart->vertices[chart->indices[f * 3 + 0]];
+            const Vector2& v2 = chart->vertices[chart->indices[f * 3 + 1]];
+            const Vector2& v3 = chart->vertices[chart->indices[f * 3 + 2]];
+            chart->parametricArea += fabsf(triangleArea(v1, v2, v3));
+        }
+        chart->parametricArea *= 0.5f;
+        if (chart->parametricArea < kAreaEpsilon)
+        {
+            // When the parametric area is too small we use a rough approximation to prevent divisions by very small numbers.
+            Vector2 minCorner(FLT_MAX, FLT_MAX);
+            Vector2 maxCorner(-FLT_MAX, -FLT_MAX);
+            for (uint32_t v = 0; v < chart->uniqueVertexCount(); v++)
+            {
+                minCorner = min(minCorner, chart->uniqueVertexAt(v));
+                maxCorner = max(maxCorner, chart->uniqueVertexAt(v));
+            }
+            const Vector2 bounds = (maxCorner - minCorner) * 0.5f;
+            chart->parametricArea = bounds.x * bounds.y;
+        }
+        XA_DEBUG_ASSERT(isFinite(chart->parametricArea));
+        XA_DEBUG_ASSERT(! isNan(chart->parametricArea));
+        chart->surfaceArea = chart->parametricArea; // Identical for UV meshes.
+        // Compute bounding box of chart.
+        // Using all unique vertices for simplicity, can compute real boundaries if this is too slow.
+        boundingBox.clear();
+        for (uint32_t v = 0; v < chart->uniqueVertexCount(); v++)
+            boundingBox.appendBoundaryVertex(chart->uniqueVertexAt(v));
+        boundingBox.compute();
+        chart->majorAxis = boundingBox.majorAxis;
+        chart->minorAxis = boundingBox.minorAxis;
+        chart->minCorner = boundingBox.minCorner;
+        chart->maxCorner = boundingBox.maxCorner;
+        return chart;
+    }
+
     bool findChartLocation(
         const PackOptions& options,
         const Vector2i& startPosition,
@@ -3298,6 +3568,7 @@ private:
         int* best_r,
         uint32_t maxResolution)
     {
+        UVULA_TRACE_ZONE("findChartLocation");
         const int attempts = 4096;
         if (options.bruteForce || attempts >= w * h)
             return findChartLocation_bruteForce(
@@ -3488,6 +3759,7 @@ private:
 
     void bilinearExpand(const Chart* chart, BitImage* source, BitImage* dest, BitImage* destRotated, UniformGrid2& boundaryEdgeGrid) const
     {
+        UVULA_TRACE_ZONE("bilinearExpand");
         boundaryEdgeGrid.reset(chart->vertices, chart->indices);
         if (chart->boundaryEdges)
         {
@@ -3563,6 +3835,7 @@ private:
 
     Array<float> m_utilization;
     Array<BitImage*> m_bitImages;
+    Array<AtlasImage*> m_atlasImages; // Only filled if PackOptions::createImage is set
     Array<Chart*> m_charts;
     RadixSort m_radix;
     uint32_t m_width = 0;
@@ -3582,13 +3855,15 @@ struct Context
     internal::Array<internal::UvMesh*> uvMeshes;
     internal::Array<internal::UvMeshInstance*> uvMeshInstances;
     bool uvMeshChartsComputed = false;
+    ProgressFunc progressFunc = nullptr;
+    void* progressUserData = nullptr;
 };
 
-Atlas* Create()
+Atlas* Create(::TaskScheduler* taskScheduler)
 {
     Context* ctx = XA_NEW(Context);
     memset(&ctx->atlas, 0, sizeof(Atlas));
-    ctx->taskScheduler = XA_NEW(internal::TaskScheduler);
+    ctx->taskScheduler = XA_NEW_ARGS(internal::TaskScheduler, taskScheduler);
     return &ctx->atlas;
 }
 
@@ -3722,7 +3997,7 @@ AddMeshError AddUvMesh(Atlas* atlas, const UvMeshDecl& decl)
     return AddMeshError::Success;
 }
 
-void SetCharts(Atlas* atlas, const std::vector<std::vector<size_t>>& grouped_faces)
+void SetCharts(Atlas* atlas, const std::pmr::vector<std::pmr::vector<size_t>>& grouped_faces)
 {
     if (! atlas)
     {
@@ -3792,10 +4067,15 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
     }
     atlas->meshCount = 0;
     // Pack charts.
+    if (ctx->progressFunc)
+    {
+        if (! ctx->progressFunc(ProgressCategory::PrepareCharts, 0, ctx->progressUserData))
+            return;
+    }
     internal::pack::Atlas packAtlas;
     for (uint32_t i = 0; i < ctx->uvMeshInstances.size(); i++)
-        packAtlas.addUvMeshCharts(ctx->uvMeshInstances[i]);
-    if (! packAtlas.packCharts(packOptions))
+        packAtlas.addUvMeshCharts(ctx->uvMeshInstances[i], ctx->taskScheduler);
+    if (! packAtlas.packCharts(packOptions, ctx->progressFunc, ctx->progressUserData))
         return;
     // Populate atlas object with pack results.
     atlas->atlasCount = packAtlas.getNumAtlases();
@@ -3809,8 +4089,19 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
         for (uint32_t i = 0; i < atlas->atlasCount; i++)
             atlas->utilization[i] = packAtlas.getUtilization(i);
     }
+    if (packOptions.createImage && atlas->atlasCount > 0)
+    {
+        atlas->image = XA_ALLOC_ARRAY(uint32_t, atlas->atlasCount * atlas->width * atlas->height);
+        for (uint32_t i = 0; i < atlas->atlasCount; i++)
+            packAtlas.getImage(i)->copyTo(&atlas->image[atlas->width * atlas->height * i], atlas->width, atlas->height, packOptions.padding);
+    }
     XA_PRINT("Building output meshes\n");
     int progress = 0;
+    if (ctx->progressFunc)
+    {
+        if (! ctx->progressFunc(ProgressCategory::BuildOutputMeshes, 0, ctx->progressUserData))
+            return;
+    }
     atlas->meshCount = ctx->uvMeshInstances.size();
     atlas->meshes = XA_ALLOC_ARRAY(Mesh, atlas->meshCount);
     memset(atlas->meshes, 0, sizeof(Mesh) * atlas->meshCount);
@@ -3822,7 +4113,7 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
         const internal::UvMeshInstance* mesh = ctx->uvMeshInstances[m];
         // Alloc arrays.
         outputMesh.vertexCount = mesh->texcoords.size();
-        outputMesh.indexCount = mesh->mesh->indices.size();
+        outputMesh.indexCount = mesh->mesh->splitIndices.size();
         outputMesh.chartCount = mesh->mesh->charts.size();
         outputMesh.vertexArray = XA_ALLOC_ARRAY(PlacedVertex, outputMesh.vertexCount);
         outputMesh.indexArray = XA_ALLOC_ARRAY(uint32_t, outputMesh.indexCount);
@@ -3835,7 +4126,7 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
             PlacedVertex& vertex = outputMesh.vertexArray[v];
             vertex.uv[0] = mesh->texcoords[v].x;
             vertex.uv[1] = mesh->texcoords[v].y;
-            vertex.xref = v;
+            vertex.xref = mesh->mesh->splitVertexXref[v];
             const uint32_t meshChartIndex = mesh->mesh->vertexToChartMap[v];
             if (meshChartIndex == UINT32_MAX)
             {
@@ -3851,7 +4142,7 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
             }
         }
         // Indices.
-        memcpy(outputMesh.indexArray, mesh->mesh->indices.data(), mesh->mesh->indices.size() * sizeof(uint32_t));
+        memcpy(outputMesh.indexArray, mesh->mesh->splitIndices.data(), mesh->mesh->splitIndices.size() * sizeof(uint32_t));
         // Charts.
         for (uint32_t c = 0; c < mesh->mesh->charts.size(); c++)
         {
@@ -3862,11 +4153,60 @@ void PackCharts(Atlas* atlas, PackOptions packOptions)
             outputChart->faceCount = chart->faces.size();
             outputChart->faceArray = XA_ALLOC_ARRAY(uint32_t, outputChart->faceCount);
             outputChart->material = chart->material;
+            outputChart->rotated = chart->rotated;
             for (uint32_t f = 0; f < outputChart->faceCount; f++)
                 outputChart->faceArray[f] = chart->faces[f];
             chartIndex++;
         }
+        if (ctx->progressFunc)
+        {
+            const int newProgress = int((m + 1) / (float)atlas->meshCount * 100.0f);
+            if (newProgress != progress)
+            {
+                progress = newProgress;
+                if (! ctx->progressFunc(ProgressCategory::BuildOutputMeshes, progress, ctx->progressUserData))
+                    return;
+            }
+        }
+    }
+}
+
+void SetProgressCallback(Atlas* atlas, ProgressFunc progressFunc, void* progressUserData)
+{
+    if (! atlas)
+    {
+        XA_PRINT_WARNING("SetProgressCallback: atlas is null.\n");
+        return;
     }
+    Context* ctx = (Context*)atlas;
+    ctx->progressFunc = progressFunc;
+    ctx->progressUserData = progressUserData;
+}
+
+void SetAlloc(ReallocFunc reallocFunc, FreeFunc freeFunc)
+{
+    internal::s_realloc = reallocFunc ? reallocFunc : realloc;
+    internal::s_free = reallocFunc ? freeFunc : free;
+}
+
+const AllocCallbacks* SetThreadAlloc(const AllocCallbacks* callbacks)
+{
+    const AllocCallbacks* previous = internal::s_threadAlloc;
+    internal::s_threadAlloc = callbacks;
+    return previous;
+}
+
+const char* StringForEnum(ProgressCategory category)
+{
+    if (category == ProgressCategory::PrepareCharts)
+        return "Preparing charts";
+    if (category == ProgressCategory::RasterizeCharts)
+        return "Rasterizing charts";
+    if (category == ProgressCategory::PlaceCharts)
+        return "Placing charts";
+    if (category == ProgressCategory::BuildOutputMeshes)
+        return "Building output meshes";
+    return "";
 }
 
 } // namespace xatlas